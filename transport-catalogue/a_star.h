@@ -0,0 +1,308 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Нижняя оценка веса кратчайшего пути from -> to. Оценка должна быть допустимой
+// (не больше настоящего веса) и согласованной: estimate(u, t) <= weight(u, v) + estimate(v, t)
+template <typename Weight>
+using LowerBound = std::function<Weight(VertexId from, VertexId to)>;
+
+// Расстояния до опорных вершин (landmarks) для оценки ALT, достаточные для восстановления без пересчета.
+// По неравенству треугольника d(v, t) >= d(L, t) - d(L, v) и d(v, t) >= d(v, L) - d(t, L)
+template <typename Weight>
+struct LandmarksData {
+	std::vector<VertexId> landmarks;
+	std::vector<Weight> from_landmarks; // d(L, v) в ячейке индекс L * количество вершин + v
+	std::vector<Weight> to_landmarks; // d(v, L) в ячейке индекс L * количество вершин + v
+};
+
+// Целенаправленный поиск A*: вершины просматриваются в порядке вес + нижняя оценка остатка пути,
+// поэтому поиск уходит от цели намного меньше, чем алгоритм Дейкстры.
+// Оценка - максимум из внешней оценки (например, по координатам) и оценки по опорным вершинам
+template <typename Weight>
+class AStarSearch {
+private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+	struct RouteInfo {
+		Weight weight;
+		std::vector<EdgeId> edges;
+	};
+
+	// Выбирает landmark_count опорных вершин и вычисляет расстояния до них
+	AStarSearch(const Graph& graph, LowerBound<Weight> lower_bound, size_t landmark_count);
+	// Использует сохраненные опорные вершины
+	AStarSearch(const Graph& graph, LowerBound<Weight> lower_bound, LandmarksData<Weight> landmarks);
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+	const LandmarksData<Weight>& GetLandmarksData() const;
+
+private:
+	// Буферы поиска переиспользуются между запросами одного потока
+	struct SearchData {
+		std::vector<Weight> weights;
+		std::vector<Weight> estimates; // оценка вычисляется один раз за поиск
+		std::vector<std::optional<EdgeId>> prev_edges;
+		std::vector<uint32_t> search_ids;
+		uint32_t search_id = 0;
+		std::vector<std::pair<Weight, VertexId>> queue; // вес + оценка, вершина
+	};
+
+	static SearchData& GetSearchData(size_t vertex_count) {
+		thread_local SearchData data;
+		if (data.search_ids.size() < vertex_count) {
+			data.weights.resize(vertex_count);
+			data.estimates.resize(vertex_count);
+			data.prev_edges.resize(vertex_count);
+			data.search_ids.resize(vertex_count, 0);
+		}
+		if (++data.search_id == 0) {
+			std::fill(data.search_ids.begin(), data.search_ids.end(), 0);
+			data.search_id = 1;
+		}
+		data.queue.clear();
+		return data;
+	}
+
+	static bool QueueCompare(const std::pair<Weight, VertexId>& lhs, const std::pair<Weight, VertexId>& rhs) {
+		return lhs.first > rhs.first;
+	}
+
+	Weight Estimate(VertexId vertex, VertexId to) const;
+	void SelectLandmarks(size_t landmark_count);
+	// Веса кратчайших путей из start во все вершины (reverse - в start из всех вершин)
+	std::vector<Weight> ComputeDistances(VertexId start, bool reverse) const;
+
+	static constexpr Weight ZERO_WEIGHT{};
+	static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+
+	const Graph& graph_;
+	LowerBound<Weight> lower_bound_;
+	LandmarksData<Weight> landmarks_;
+	// Входящие ребра каждой вершины для обратного поиска, нужны только при выборе опорных вершин
+	std::vector<size_t> in_offsets_;
+	std::vector<EdgeId> in_edges_;
+};
+
+template <typename Weight>
+AStarSearch<Weight>::AStarSearch(const Graph& graph, LowerBound<Weight> lower_bound, size_t landmark_count)
+	: graph_(graph)
+	, lower_bound_(std::move(lower_bound))
+{
+	static_assert(std::numeric_limits<Weight>::has_infinity, "Weight should have infinity value");
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+		if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+			throw std::domain_error("Edges' weights should be non-negative");
+		}
+	}
+	SelectLandmarks(landmark_count);
+}
+
+template <typename Weight>
+AStarSearch<Weight>::AStarSearch(const Graph& graph, LowerBound<Weight> lower_bound, LandmarksData<Weight> landmarks)
+	: graph_(graph)
+	, lower_bound_(std::move(lower_bound))
+	, landmarks_(std::move(landmarks))
+{
+	const size_t table_size = landmarks_.landmarks.size() * graph.GetVertexCount();
+	if (landmarks_.from_landmarks.size() != table_size || landmarks_.to_landmarks.size() != table_size) {
+		throw std::invalid_argument("Landmarks don't match the graph");
+	}
+}
+
+template <typename Weight>
+const LandmarksData<Weight>& AStarSearch<Weight>::GetLandmarksData() const {
+	return landmarks_;
+}
+
+template <typename Weight>
+std::vector<Weight> AStarSearch<Weight>::ComputeDistances(VertexId start, bool reverse) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+	std::vector<std::pair<Weight, VertexId>> queue;
+	weights[start] = ZERO_WEIGHT;
+	queue.emplace_back(ZERO_WEIGHT, start);
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), QueueCompare);
+		const auto [weight, vertex] = queue.back();
+		queue.pop_back();
+		if (weights[vertex] < weight) {
+			continue;
+		}
+		const auto relax = [&](VertexId next, Weight edge_weight) {
+			const Weight candidate = weight + edge_weight;
+			if (candidate < weights[next]) {
+				weights[next] = candidate;
+				queue.emplace_back(candidate, next);
+				std::push_heap(queue.begin(), queue.end(), QueueCompare);
+			}
+		};
+		if (reverse) {
+			for (size_t i = in_offsets_[vertex]; i < in_offsets_[vertex + 1]; ++i) {
+				const auto& edge = graph_.GetEdge(in_edges_[i]);
+				relax(edge.from, edge.weight);
+			}
+		} else {
+			for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+				const auto& edge = graph_.GetEdge(edge_id);
+				relax(edge.to, edge.weight);
+			}
+		}
+	}
+	return weights;
+}
+
+// Опорные вершины выбираются по очереди как самые удаленные от уже выбранных:
+// оценка точнее всего для целей, лежащих "за" опорной вершиной
+template <typename Weight>
+void AStarSearch<Weight>::SelectLandmarks(size_t landmark_count) {
+	const size_t vertex_count = graph_.GetVertexCount();
+	landmark_count = std::min(landmark_count, vertex_count);
+	if (landmark_count == 0) {
+		return;
+	}
+	in_offsets_.assign(vertex_count + 1, 0);
+	for (const auto& edge : graph_.GetEdges()) {
+		++in_offsets_[edge.to + 1];
+	}
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		in_offsets_[vertex + 1] += in_offsets_[vertex];
+	}
+	in_edges_.resize(graph_.GetEdgeCount());
+	std::vector<size_t> positions(in_offsets_.begin(), in_offsets_.end() - 1);
+	for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+		in_edges_[positions[graph_.GetEdge(edge_id).to]++] = edge_id;
+	}
+
+	landmarks_ = {};
+	landmarks_.from_landmarks.reserve(landmark_count * vertex_count);
+	landmarks_.to_landmarks.reserve(landmark_count * vertex_count);
+	// Расстояние до вершины от ближайшей опорной. Первая опорная - самая удаленная
+	// от произвольной вершины, из которой выходят ребра
+	VertexId start = 0;
+	while (start + 1 < vertex_count && graph_.GetIncidentEdges(start).begin() == graph_.GetIncidentEdges(start).end()) {
+		++start;
+	}
+	std::vector<Weight> nearest = ComputeDistances(start, false);
+	while (landmarks_.landmarks.size() < landmark_count) {
+		std::optional<VertexId> farthest;
+		for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+			if (nearest[vertex] != INFINITE_WEIGHT && nearest[vertex] > ZERO_WEIGHT
+				&& (!farthest || nearest[*farthest] < nearest[vertex]))
+			{
+				farthest = vertex;
+			}
+		}
+		if (!farthest) {
+			break;
+		}
+
+		const std::vector<Weight> from_landmark = ComputeDistances(*farthest, false);
+		const std::vector<Weight> to_landmark = ComputeDistances(*farthest, true);
+		landmarks_.landmarks.push_back(*farthest);
+		landmarks_.from_landmarks.insert(landmarks_.from_landmarks.end(), from_landmark.begin(), from_landmark.end());
+		landmarks_.to_landmarks.insert(landmarks_.to_landmarks.end(), to_landmark.begin(), to_landmark.end());
+		if (landmarks_.landmarks.size() == 1) {
+			nearest = from_landmark;
+		} else {
+			for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+				nearest[vertex] = std::min(nearest[vertex], from_landmark[vertex]);
+			}
+		}
+	}
+	std::vector<size_t>().swap(in_offsets_);
+	std::vector<EdgeId>().swap(in_edges_);
+}
+
+template <typename Weight>
+Weight AStarSearch<Weight>::Estimate(VertexId vertex, VertexId to) const {
+	Weight result = lower_bound_ ? lower_bound_(vertex, to) : ZERO_WEIGHT;
+	const size_t vertex_count = graph_.GetVertexCount();
+	for (size_t i = 0; i < landmarks_.landmarks.size(); ++i) {
+		const Weight* from_landmark = landmarks_.from_landmarks.data() + i * vertex_count;
+		const Weight* to_landmark = landmarks_.to_landmarks.data() + i * vertex_count;
+		// Если путь через опорную вершину не существует, она ничего не говорит о паре
+		if (from_landmark[to] != INFINITE_WEIGHT && from_landmark[vertex] != INFINITE_WEIGHT) {
+			result = std::max(result, from_landmark[to] - from_landmark[vertex]);
+		}
+		if (to_landmark[vertex] != INFINITE_WEIGHT && to_landmark[to] != INFINITE_WEIGHT) {
+			result = std::max(result, to_landmark[vertex] - to_landmark[to]);
+		}
+	}
+	return result;
+}
+
+template <typename Weight>
+std::optional<typename AStarSearch<Weight>::RouteInfo> AStarSearch<Weight>::BuildRoute(VertexId from, VertexId to) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count || to >= vertex_count) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+
+	SearchData& data = GetSearchData(vertex_count);
+	auto& queue = data.queue;
+	data.search_ids[from] = data.search_id;
+	data.weights[from] = ZERO_WEIGHT;
+	data.estimates[from] = Estimate(from, to);
+	data.prev_edges[from] = std::nullopt;
+	queue.emplace_back(data.estimates[from], from);
+
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), QueueCompare);
+		const auto [priority, vertex] = queue.back();
+		queue.pop_back();
+		const Weight weight = data.weights[vertex];
+		if (weight + data.estimates[vertex] < priority) {
+			// Устаревшая запись: вершина уже достигнута более коротким путем
+			continue;
+		}
+		if (vertex == to) {
+			break;
+		}
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+			const auto& edge = graph_.GetEdge(edge_id);
+			const Weight candidate_weight = weight + edge.weight;
+			const bool visited = data.search_ids[edge.to] == data.search_id;
+			if (!visited || candidate_weight < data.weights[edge.to]) {
+				if (!visited) {
+					data.search_ids[edge.to] = data.search_id;
+					data.estimates[edge.to] = Estimate(edge.to, to);
+				}
+				data.weights[edge.to] = candidate_weight;
+				data.prev_edges[edge.to] = edge_id;
+				queue.emplace_back(candidate_weight + data.estimates[edge.to], edge.to);
+				std::push_heap(queue.begin(), queue.end(), QueueCompare);
+			}
+		}
+	}
+
+	if (data.search_ids[to] != data.search_id) {
+		return std::nullopt;
+	}
+
+	std::vector<EdgeId> edges;
+	for (std::optional<EdgeId> edge_id = data.prev_edges[to];
+		edge_id;
+		edge_id = data.prev_edges[graph_.GetEdge(*edge_id).from])
+	{
+		edges.push_back(*edge_id);
+	}
+	std::reverse(edges.begin(), edges.end());
+
+	return RouteInfo{data.weights[to], std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,567 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Результат предподсчета иерархии сжатия, достаточный для ее восстановления без повторного сжатия.
+// Дуги иерархии нумеруются так: сначала все ребра графа (номер дуги равен номеру ребра),
+// затем ярлыки (номер дуги = количество ребер графа + индекс ярлыка)
+template <typename Weight>
+struct HierarchyData {
+	struct Shortcut {
+		VertexId from;
+		VertexId to;
+		Weight weight;
+		// Две дуги, путь по которым заменяет ярлык
+		EdgeId first;
+		EdgeId second;
+	};
+	std::vector<uint32_t> ranks; // порядковый номер сжатия вершины, ключ - индекс вершины
+	std::vector<Shortcut> shortcuts;
+};
+
+// Иерархия сжатия (Contraction Hierarchies): вершины по очереди удаляются из графа,
+// а кратчайшие пути через удаленную вершину заменяются ярлыками. Запрос - двунаправленный поиск
+// только по дугам, ведущим к вершинам с большим рангом, поэтому просматривает малую часть графа
+template <typename Weight>
+class ContractionHierarchy {
+private:
+	using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+	struct RouteInfo {
+		Weight weight;
+		std::vector<EdgeId> edges;
+	};
+
+	// Выполняет сжатие графа
+	explicit ContractionHierarchy(const Graph& graph);
+	// Восстанавливает иерархию по сохраненным данным
+	ContractionHierarchy(const Graph& graph, HierarchyData<Weight> data);
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	// Веса маршрутов между всеми парами sources x targets построчно (см. Router::BuildWeights)
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+		const std::vector<VertexId>& targets) const;
+
+	const HierarchyData<Weight>& GetData() const;
+
+private:
+	struct Arc {
+		VertexId from;
+		VertexId to;
+		Weight weight;
+	};
+
+	Arc GetArc(EdgeId arc_id) const {
+		const size_t edge_count = graph_.GetEdgeCount();
+		if (arc_id < edge_count) {
+			const auto& edge = graph_.GetEdge(arc_id);
+			return {edge.from, edge.to, edge.weight};
+		}
+		const auto& shortcut = data_.shortcuts[arc_id - edge_count];
+		return {shortcut.from, shortcut.to, shortcut.weight};
+	}
+
+	// Поиск в одном направлении по дугам вверх по иерархии
+	struct SearchData {
+		std::vector<Weight> weights;
+		std::vector<EdgeId> prev_arcs;
+		std::vector<uint32_t> search_ids;
+		std::vector<std::pair<Weight, VertexId>> queue;
+
+		void Resize(size_t vertex_count) {
+			if (search_ids.size() < vertex_count) {
+				weights.resize(vertex_count);
+				prev_arcs.resize(vertex_count);
+				search_ids.resize(vertex_count, 0);
+			}
+			queue.clear();
+		}
+	};
+	struct QueryData {
+		SearchData forward;
+		SearchData backward;
+		uint32_t search_id = 0;
+	};
+
+	static QueryData& GetQueryData(size_t vertex_count) {
+		thread_local QueryData data;
+		data.forward.Resize(vertex_count);
+		data.backward.Resize(vertex_count);
+		if (++data.search_id == 0) {
+			std::fill(data.forward.search_ids.begin(), data.forward.search_ids.end(), 0);
+			std::fill(data.backward.search_ids.begin(), data.backward.search_ids.end(), 0);
+			data.search_id = 1;
+		}
+		return data;
+	}
+
+	static bool QueueCompare(const std::pair<Weight, VertexId>& lhs, const std::pair<Weight, VertexId>& rhs) {
+		return lhs.first > rhs.first;
+	}
+
+	void Contract();
+	void BuildUpwardArcs();
+	void UnpackArc(EdgeId arc_id, std::vector<EdgeId>& edges) const;
+	// Полный поиск вверх по иерархии из start: вперед по исходящим дугам или назад по входящим.
+	// Для каждой просмотренной вершины вызывается on_settle(vertex, weight)
+	template <typename Callback>
+	void SearchUpward(VertexId start, bool forward, Callback on_settle) const;
+
+	static constexpr Weight ZERO_WEIGHT{};
+	// Ограничения на число вершин, просматриваемых при поиске свидетеля: при оценке приоритета
+	// и при сжатии. Если свидетель не найден, добавляется лишний ярлык, что не влияет на правильность ответа
+	static constexpr size_t ESTIMATE_SETTLE_LIMIT = 50;
+	static constexpr size_t CONTRACT_SETTLE_LIMIT = 500;
+
+	const Graph& graph_;
+	HierarchyData<Weight> data_;
+	// Дуги из вершины в вершины с большим рангом
+	std::vector<size_t> up_out_offsets_;
+	std::vector<EdgeId> up_out_arcs_;
+	// Дуги в вершину из вершин с большим рангом
+	std::vector<size_t> up_in_offsets_;
+	std::vector<EdgeId> up_in_arcs_;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+	: graph_(graph)
+{
+	for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+		if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+			throw std::domain_error("Edges' weights should be non-negative");
+		}
+	}
+	Contract();
+	BuildUpwardArcs();
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, HierarchyData<Weight> data)
+	: graph_(graph)
+	, data_(std::move(data))
+{
+	const size_t arc_count = graph.GetEdgeCount() + data_.shortcuts.size();
+	if (data_.ranks.size() != graph.GetVertexCount()) {
+		throw std::invalid_argument("Hierarchy doesn't match the graph");
+	}
+	for (const auto& shortcut : data_.shortcuts) {
+		if (shortcut.first >= arc_count || shortcut.second >= arc_count
+			|| shortcut.from >= graph.GetVertexCount() || shortcut.to >= graph.GetVertexCount())
+		{
+			throw std::invalid_argument("Hierarchy doesn't match the graph");
+		}
+	}
+	BuildUpwardArcs();
+}
+
+template <typename Weight>
+const HierarchyData<Weight>& ContractionHierarchy<Weight>::GetData() const {
+	return data_;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Contract() {
+	const size_t vertex_count = graph_.GetVertexCount();
+	const size_t edge_count = graph_.GetEdgeCount();
+
+	// Дуги еще не сжатой части графа. Дуги к уже сжатым вершинам пропускаются при обходе
+	std::vector<std::vector<EdgeId>> out_arcs(vertex_count);
+	std::vector<std::vector<EdgeId>> in_arcs(vertex_count);
+	for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+		const auto& edge = graph_.GetEdge(edge_id);
+		if (edge.from != edge.to) {
+			out_arcs[edge.from].push_back(edge_id);
+			in_arcs[edge.to].push_back(edge_id);
+		}
+	}
+	std::vector<bool> contracted(vertex_count, false);
+	std::vector<int> contracted_neighbours(vertex_count, 0);
+
+	// Буферы поиска свидетеля
+	std::vector<Weight> witness_weights(vertex_count);
+	std::vector<uint32_t> witness_ids(vertex_count, 0);
+	uint32_t witness_id = 0;
+	std::vector<std::pair<Weight, VertexId>> witness_queue;
+
+	// Оставляет для каждой соседней вершины одну самую легкую дугу
+	const auto select_arcs = [this, &contracted](const std::vector<EdgeId>& arcs, bool by_target) {
+		std::vector<std::pair<VertexId, EdgeId>> result;
+		for (const EdgeId arc_id : arcs) {
+			const Arc arc = GetArc(arc_id);
+			const VertexId neighbour = by_target ? arc.to : arc.from;
+			if (!contracted[neighbour]) {
+				result.emplace_back(neighbour, arc_id);
+			}
+		}
+		std::sort(result.begin(), result.end(), [this](const auto& lhs, const auto& rhs) {
+			if (lhs.first != rhs.first) {
+				return lhs.first < rhs.first;
+			}
+			return GetArc(lhs.second).weight < GetArc(rhs.second).weight;
+		});
+		result.erase(std::unique(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.first == rhs.first;
+		}), result.end());
+		return result;
+	};
+
+	// Находит ярлыки, необходимые при сжатии вершины. Если add == false, только считает их
+	const auto process_vertex = [&](VertexId vertex, bool add) {
+		const auto ins = select_arcs(in_arcs[vertex], false);
+		const auto outs = select_arcs(out_arcs[vertex], true);
+		size_t shortcut_count = 0;
+		for (const auto& [source, in_arc_id] : ins) {
+			const Weight in_weight = GetArc(in_arc_id).weight;
+			std::optional<Weight> max_weight;
+			for (const auto& [target, out_arc_id] : outs) {
+				const Weight candidate = in_weight + GetArc(out_arc_id).weight;
+				if (target != source && (!max_weight || *max_weight < candidate)) {
+					max_weight = candidate;
+				}
+			}
+			if (!max_weight) {
+				continue;
+			}
+
+			// Поиск свидетеля: кратчайшие пути из source, не проходящие через vertex
+			if (++witness_id == 0) {
+				std::fill(witness_ids.begin(), witness_ids.end(), 0);
+				witness_id = 1;
+			}
+			witness_queue.clear();
+			witness_ids[source] = witness_id;
+			witness_weights[source] = ZERO_WEIGHT;
+			witness_queue.emplace_back(ZERO_WEIGHT, source);
+			const size_t settle_limit = add ? CONTRACT_SETTLE_LIMIT : ESTIMATE_SETTLE_LIMIT;
+			size_t settled = 0;
+			while (!witness_queue.empty() && settled < settle_limit) {
+				std::pop_heap(witness_queue.begin(), witness_queue.end(), QueueCompare);
+				const auto [weight, current] = witness_queue.back();
+				witness_queue.pop_back();
+				if (witness_weights[current] < weight) {
+					continue;
+				}
+				if (*max_weight < weight) {
+					break;
+				}
+				++settled;
+				for (const EdgeId arc_id : out_arcs[current]) {
+					const Arc arc = GetArc(arc_id);
+					if (arc.to == vertex || contracted[arc.to]) {
+						continue;
+					}
+					const Weight candidate = weight + arc.weight;
+					if (witness_ids[arc.to] != witness_id || candidate < witness_weights[arc.to]) {
+						witness_ids[arc.to] = witness_id;
+						witness_weights[arc.to] = candidate;
+						witness_queue.emplace_back(candidate, arc.to);
+						std::push_heap(witness_queue.begin(), witness_queue.end(), QueueCompare);
+					}
+				}
+			}
+
+			for (const auto& [target, out_arc_id] : outs) {
+				if (target == source) {
+					continue;
+				}
+				const Weight candidate = in_weight + GetArc(out_arc_id).weight;
+				if (witness_ids[target] == witness_id && !(candidate < witness_weights[target])) {
+					continue;
+				}
+				++shortcut_count;
+				if (add) {
+					const EdgeId arc_id = edge_count + data_.shortcuts.size();
+					data_.shortcuts.push_back({source, target, candidate, in_arc_id, out_arc_id});
+					out_arcs[source].push_back(arc_id);
+					in_arcs[target].push_back(arc_id);
+				}
+			}
+		}
+		return std::pair{shortcut_count, ins.size() + outs.size()};
+	};
+
+	// Приоритет вершины: разность добавляемых и удаляемых дуг плюс число уже сжатых соседей.
+	// Сначала сжимаются вершины, удаление которых меньше всего усложняет граф
+	const auto get_priority = [&](VertexId vertex) {
+		const auto [shortcut_count, arc_count] = process_vertex(vertex, false);
+		return static_cast<long long>(shortcut_count) - static_cast<long long>(arc_count)
+			+ contracted_neighbours[vertex];
+	};
+
+	using QueueItem = std::pair<long long, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		queue.emplace(get_priority(vertex), vertex);
+	}
+
+	data_.ranks.assign(vertex_count, 0);
+	uint32_t rank = 0;
+	while (!queue.empty()) {
+		const VertexId vertex = queue.top().second;
+		queue.pop();
+		if (contracted[vertex]) {
+			continue;
+		}
+		// Приоритет мог устареть после сжатия соседей
+		const long long priority = get_priority(vertex);
+		if (!queue.empty() && priority > queue.top().first) {
+			queue.emplace(priority, vertex);
+			continue;
+		}
+
+		process_vertex(vertex, true);
+		contracted[vertex] = true;
+		data_.ranks[vertex] = rank++;
+
+		// Соседи забывают дуги, ведущие в сжатую вершину
+		const auto is_arc_to_contracted = [this, &contracted](EdgeId arc_id) {
+			const Arc arc = GetArc(arc_id);
+			return contracted[arc.from] || contracted[arc.to];
+		};
+		const auto forget_vertex = [&](const std::vector<EdgeId>& arcs,
+			std::vector<std::vector<EdgeId>>& neighbours_arcs, bool by_target)
+		{
+			for (const EdgeId arc_id : arcs) {
+				const Arc arc = GetArc(arc_id);
+				const VertexId neighbour = by_target ? arc.to : arc.from;
+				if (contracted[neighbour]) {
+					continue;
+				}
+				auto& neighbour_arcs = neighbours_arcs[neighbour];
+				neighbour_arcs.erase(std::remove_if(neighbour_arcs.begin(), neighbour_arcs.end(),
+					is_arc_to_contracted), neighbour_arcs.end());
+				++contracted_neighbours[neighbour];
+			}
+		};
+		forget_vertex(out_arcs[vertex], in_arcs, true);
+		forget_vertex(in_arcs[vertex], out_arcs, false);
+		std::vector<EdgeId>().swap(out_arcs[vertex]);
+		std::vector<EdgeId>().swap(in_arcs[vertex]);
+	}
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildUpwardArcs() {
+	const size_t vertex_count = graph_.GetVertexCount();
+	const size_t arc_count = graph_.GetEdgeCount() + data_.shortcuts.size();
+
+	up_out_offsets_.assign(vertex_count + 1, 0);
+	up_in_offsets_.assign(vertex_count + 1, 0);
+	for (EdgeId arc_id = 0; arc_id < arc_count; ++arc_id) {
+		const Arc arc = GetArc(arc_id);
+		if (data_.ranks[arc.from] < data_.ranks[arc.to]) {
+			++up_out_offsets_[arc.from + 1];
+		} else if (data_.ranks[arc.to] < data_.ranks[arc.from]) {
+			++up_in_offsets_[arc.to + 1];
+		}
+	}
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		up_out_offsets_[vertex + 1] += up_out_offsets_[vertex];
+		up_in_offsets_[vertex + 1] += up_in_offsets_[vertex];
+	}
+
+	up_out_arcs_.resize(up_out_offsets_.back());
+	up_in_arcs_.resize(up_in_offsets_.back());
+	std::vector<size_t> out_positions(up_out_offsets_.begin(), up_out_offsets_.end() - 1);
+	std::vector<size_t> in_positions(up_in_offsets_.begin(), up_in_offsets_.end() - 1);
+	for (EdgeId arc_id = 0; arc_id < arc_count; ++arc_id) {
+		const Arc arc = GetArc(arc_id);
+		if (data_.ranks[arc.from] < data_.ranks[arc.to]) {
+			up_out_arcs_[out_positions[arc.from]++] = arc_id;
+		} else if (data_.ranks[arc.to] < data_.ranks[arc.from]) {
+			up_in_arcs_[in_positions[arc.to]++] = arc_id;
+		}
+	}
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackArc(EdgeId arc_id, std::vector<EdgeId>& edges) const {
+	const size_t edge_count = graph_.GetEdgeCount();
+	std::vector<EdgeId> stack{arc_id};
+	while (!stack.empty()) {
+		const EdgeId current = stack.back();
+		stack.pop_back();
+		if (current < edge_count) {
+			edges.push_back(current);
+		} else {
+			const auto& shortcut = data_.shortcuts[current - edge_count];
+			stack.push_back(shortcut.second);
+			stack.push_back(shortcut.first);
+		}
+	}
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(
+	VertexId from, VertexId to) const
+{
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count || to >= vertex_count) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+
+	QueryData& data = GetQueryData(vertex_count);
+	const uint32_t search_id = data.search_id;
+	SearchData* searches[2] = {&data.forward, &data.backward};
+
+	searches[0]->search_ids[from] = search_id;
+	searches[0]->weights[from] = ZERO_WEIGHT;
+	searches[0]->queue.emplace_back(ZERO_WEIGHT, from);
+	searches[1]->search_ids[to] = search_id;
+	searches[1]->weights[to] = ZERO_WEIGHT;
+	searches[1]->queue.emplace_back(ZERO_WEIGHT, to);
+
+	std::optional<Weight> best_weight;
+	VertexId meeting_vertex = from;
+
+	// Поиски вперед и назад ведутся поочередно; направление останавливается,
+	// когда все непросмотренные вершины дальше лучшего найденного пути
+	for (size_t direction = 0; !searches[0]->queue.empty() || !searches[1]->queue.empty(); direction ^= 1) {
+		SearchData& search = *searches[direction];
+		const SearchData& other = *searches[direction ^ 1];
+		if (search.queue.empty()) {
+			continue;
+		}
+		std::pop_heap(search.queue.begin(), search.queue.end(), QueueCompare);
+		const auto [weight, vertex] = search.queue.back();
+		search.queue.pop_back();
+		if (search.weights[vertex] < weight) {
+			continue;
+		}
+		if (best_weight && !(weight < *best_weight)) {
+			search.queue.clear();
+			continue;
+		}
+		if (other.search_ids[vertex] == search_id) {
+			const Weight candidate = weight + other.weights[vertex];
+			if (!best_weight || candidate < *best_weight) {
+				best_weight = candidate;
+				meeting_vertex = vertex;
+			}
+		}
+
+		const auto& offsets = direction == 0 ? up_out_offsets_ : up_in_offsets_;
+		const auto& arcs = direction == 0 ? up_out_arcs_ : up_in_arcs_;
+		for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+			const Arc arc = GetArc(arcs[i]);
+			const VertexId next = direction == 0 ? arc.to : arc.from;
+			const Weight candidate = weight + arc.weight;
+			if (search.search_ids[next] != search_id || candidate < search.weights[next]) {
+				search.search_ids[next] = search_id;
+				search.weights[next] = candidate;
+				search.prev_arcs[next] = arcs[i];
+				search.queue.emplace_back(candidate, next);
+				std::push_heap(search.queue.begin(), search.queue.end(), QueueCompare);
+			}
+		}
+	}
+
+	if (!best_weight) {
+		return std::nullopt;
+	}
+
+	// Дуги от начала до точки встречи, затем от точки встречи до конца
+	std::vector<EdgeId> forward_arcs;
+	for (VertexId vertex = meeting_vertex; vertex != from; ) {
+		const EdgeId arc_id = data.forward.prev_arcs[vertex];
+		forward_arcs.push_back(arc_id);
+		vertex = GetArc(arc_id).from;
+	}
+	std::reverse(forward_arcs.begin(), forward_arcs.end());
+	for (VertexId vertex = meeting_vertex; vertex != to; ) {
+		const EdgeId arc_id = data.backward.prev_arcs[vertex];
+		forward_arcs.push_back(arc_id);
+		vertex = GetArc(arc_id).to;
+	}
+
+	std::vector<EdgeId> edges;
+	for (const EdgeId arc_id : forward_arcs) {
+		UnpackArc(arc_id, edges);
+	}
+	return RouteInfo{*best_weight, std::move(edges)};
+}
+
+// Многие-ко-многим через корзины: поиск назад из каждой цели оставляет в просмотренных вершинах
+// записи (цель, вес), а поиск вперед из каждого источника собирает их. Любой кратчайший путь
+// в иерархии поднимается до вершины с наибольшим рангом и спускается, поэтому встреча найдется
+template <typename Weight>
+std::vector<std::optional<Weight>> ContractionHierarchy<Weight>::BuildWeights(
+	const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const
+{
+	const size_t vertex_count = graph_.GetVertexCount();
+	std::vector<std::vector<std::pair<size_t, Weight>>> buckets(vertex_count);
+	for (size_t j = 0; j < targets.size(); ++j) {
+		SearchUpward(targets[j], false, [&buckets, j](VertexId vertex, Weight weight) {
+			buckets[vertex].emplace_back(j, weight);
+		});
+	}
+
+	std::vector<std::optional<Weight>> result(sources.size() * targets.size());
+	for (size_t i = 0; i < sources.size(); ++i) {
+		std::optional<Weight>* row = result.data() + i * targets.size();
+		SearchUpward(sources[i], true, [&buckets, row](VertexId vertex, Weight weight) {
+			for (const auto& [target_index, target_weight] : buckets[vertex]) {
+				const Weight candidate = weight + target_weight;
+				if (!row[target_index] || candidate < *row[target_index]) {
+					row[target_index] = candidate;
+				}
+			}
+		});
+	}
+	return result;
+}
+
+template <typename Weight>
+template <typename Callback>
+void ContractionHierarchy<Weight>::SearchUpward(VertexId start, bool forward, Callback on_settle) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (start >= vertex_count) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+
+	QueryData& data = GetQueryData(vertex_count);
+	const uint32_t search_id = data.search_id;
+	SearchData& search = data.forward;
+	const auto& offsets = forward ? up_out_offsets_ : up_in_offsets_;
+	const auto& arcs = forward ? up_out_arcs_ : up_in_arcs_;
+
+	search.search_ids[start] = search_id;
+	search.weights[start] = ZERO_WEIGHT;
+	search.queue.emplace_back(ZERO_WEIGHT, start);
+	while (!search.queue.empty()) {
+		std::pop_heap(search.queue.begin(), search.queue.end(), QueueCompare);
+		const auto [weight, vertex] = search.queue.back();
+		search.queue.pop_back();
+		if (search.weights[vertex] < weight) {
+			continue;
+		}
+		on_settle(vertex, weight);
+
+		for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+			const Arc arc = GetArc(arcs[i]);
+			const VertexId next = forward ? arc.to : arc.from;
+			const Weight candidate = weight + arc.weight;
+			if (search.search_ids[next] != search_id || candidate < search.weights[next]) {
+				search.search_ids[next] = search_id;
+				search.weights[next] = candidate;
+				search.queue.emplace_back(candidate, next);
+				std::push_heap(search.queue.begin(), search.queue.end(), QueueCompare);
+			}
+		}
+	}
+}
+
+}  // namespace graph
@@ -1,26 +1,119 @@
 #pragma once
 
 #include "geo.h"
-#include <string>
-#include <set>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
 #include <vector>
 
 namespace transport::domain {
 	using geo::Coordinates;
 
+	// Плотные индексы справочника: остановки и маршруты нумеруются подряд в порядке добавления
+	using StopId = uint32_t;
+	using BusId = uint32_t;
+
+	// Названия хранятся в справочнике, здесь - ссылки на них
 	struct Stop {
-		std::string name;
+		StopId id;
+		std::string_view name;
 		Coordinates coordinates;
-		std::set<std::string_view> buses;
+		std::vector<std::string_view> buses; // названия маршрутов по возрастанию, без повторов
 	};
 	using StopPtr = const Stop*;
 
+	// Полная последовательность остановок маршрута без копирования: у некольцевого маршрута
+	// за остановками пути в одну сторону идут они же в обратном порядке, без конечной
+	class RouteStops {
+	public:
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = StopId;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const StopId*;
+			using reference = const StopId&;
+
+			Iterator(const std::vector<StopId> * stops, size_t index)
+				: stops_(stops), index_(index) {}
+
+			reference operator*() const {
+				return GetStop(*stops_, index_);
+			}
+			Iterator & operator++() {
+				++index_;
+				return *this;
+			}
+			Iterator operator++(int) {
+				Iterator result = *this;
+				++index_;
+				return result;
+			}
+			// Индекс остановки в полной последовательности
+			size_t GetIndex() const {
+				return index_;
+			}
+			bool operator==(const Iterator & other) const {
+				return index_ == other.index_;
+			}
+			bool operator!=(const Iterator & other) const {
+				return index_ != other.index_;
+			}
+
+		private:
+			const std::vector<StopId> * stops_;
+			size_t index_;
+		};
+
+		RouteStops(const std::vector<StopId> & stops, bool is_looped)
+			: stops_(&stops), is_looped_(is_looped) {}
+
+		size_t size() const {
+			if (is_looped_ || stops_->empty()) {
+				return stops_->size();
+			}
+			return stops_->size() * 2 - 1;
+		}
+		bool empty() const {
+			return stops_->empty();
+		}
+		const StopId & operator[](size_t index) const {
+			return GetStop(*stops_, index);
+		}
+		Iterator begin() const {
+			return Iterator(stops_, 0);
+		}
+		Iterator end() const {
+			return Iterator(stops_, size());
+		}
+
+	private:
+		static const StopId & GetStop(const std::vector<StopId> & stops, size_t index) {
+			return index < stops.size() ? stops[index] : stops[stops.size() * 2 - 2 - index];
+		}
+
+		const std::vector<StopId> * stops_;
+		bool is_looped_;
+	};
+
 	struct Bus {
-		std::string name;
+		BusId id;
+		std::string_view name;
 		bool is_looped; // для сериализации/десерриализации
-		StopPtr start; // для отрисовки конечных меток
-		StopPtr finish; // для отрисовки конечных меток
-		std::vector<const Stop*> stops;
+		StopId start; // для отрисовки конечных меток
+		StopId finish; // для отрисовки конечных меток
+		// Остановки в заданном порядке, у некольцевого маршрута - только путь в одну сторону.
+		// Полный путь туда и обратно - GetRouteStops
+		std::vector<StopId> stops;
+		// Расстояние от начала маршрута до остановки с тем же индексом в GetRouteStops, метры:
+		// по дорогам и по прямой между соседними остановками
+		std::vector<uint64_t> distances;
+		std::vector<double> geo_distances;
+
+		RouteStops GetRouteStops() const {
+			return RouteStops(stops, is_looped);
+		}
 	};
 	using BusPtr = const Bus*;
 }
@@ -1,6 +1,8 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
+#include <algorithm>
 #include <cmath>
+#include <utility>
 
 namespace transport::geo {
 	constexpr int EARTH_RADIUS = 6371000;
@@ -15,4 +17,34 @@ namespace transport::geo {
 			+ cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
 			* EARTH_RADIUS;
 	}
+
+	uint64_t ComputeHilbertIndex(Coordinates point, Coordinates min, Coordinates max) {
+		constexpr uint32_t side = 1u << 16;
+		const auto to_cell = [](double value, double min_value, double max_value) {
+			if (max_value <= min_value) {
+				return 0u;
+			}
+			const double position = (value - min_value) / (max_value - min_value) * (side - 1);
+			return static_cast<uint32_t>(std::clamp(position, 0.0, side - 1.0));
+		};
+		uint32_t x = to_cell(point.lng, min.lng, max.lng);
+		uint32_t y = to_cell(point.lat, min.lat, max.lat);
+
+		// На каждом уровне четверть квадрата задает два бита номера, затем точка переводится
+		// в систему координат этой четверти
+		uint64_t result = 0;
+		for (uint32_t half = side / 2; half > 0; half /= 2) {
+			const uint32_t rx = (x & half) ? 1 : 0;
+			const uint32_t ry = (y & half) ? 1 : 0;
+			result += static_cast<uint64_t>(half) * half * ((3 * rx) ^ ry);
+			if (ry == 0) {
+				if (rx == 1) {
+					x = side - 1 - x;
+					y = side - 1 - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return result;
+	}
 }
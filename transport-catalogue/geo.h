@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace transport::geo {
 	struct Coordinates {
 		double lat;
@@ -13,4 +15,7 @@ namespace transport::geo {
 	};
 
 	double ComputeDistance(Coordinates from, Coordinates to);
+	// Номер точки на кривой Гильберта, заполняющей прямоугольник от min до max сеткой 2^16 x 2^16.
+	// У точек с близкими номерами близкие координаты
+	uint64_t ComputeHilbertIndex(Coordinates point, Coordinates min, Coordinates max);
 }
@@ -2,7 +2,10 @@
 
 #include "ranges.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <optional>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -17,6 +20,10 @@ struct Edge {
 	Weight weight;
 };
 
+// Граф хранится в сжатом виде (CSR): исходящие ребра всех вершин лежат в одном массиве
+// подряд, отсортированные по вершине-началу, а offsets_[v] указывает на начало ребер вершины v.
+// Идентификатор ребра - его номер в порядке добавления, он не меняется при перестройке массива.
+// Удаление ребер перенумеровывает оставшиеся с сохранением порядка
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
@@ -26,34 +33,111 @@ private:
 public:
 	DirectedWeightedGraph() = default;
 	explicit DirectedWeightedGraph(size_t vertex_count);
-	EdgeId AddEdge(const Edge<Weight>& edge);
+	// Построение графа сразу по всем ребрам за O(V + E)
+	DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
+	// Добавляет count вершин без ребер, их идентификаторы следуют за существующими
+	void AddVertices(size_t count);
+	// Добавляет ребра за O(V + E), возвращает идентификатор первого из них
+	EdgeId AddEdges(std::vector<Edge<Weight>> edges);
+	// Удаляет ребра, для которых is_removed(edge_id) истинно, за O(V + E).
+	// Возвращает новый идентификатор для каждого старого, у удаленных ребер - nullopt
+	template <typename Predicate>
+	std::vector<std::optional<EdgeId>> RemoveEdges(Predicate is_removed);
 
 	size_t GetVertexCount() const;
 	size_t GetEdgeCount() const;
 	const Edge<Weight>& GetEdge(EdgeId edge_id) const;
+	const std::vector<Edge<Weight>>& GetEdges() const;
 	IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
 private:
+	void CheckEdges(EdgeId first_edge) const;
+	void BuildIncidence();
+
 	std::vector<Edge<Weight>> edges_;
-	std::vector<IncidenceList> incidence_lists_;
+	std::vector<size_t> offsets_ = {0};
+	IncidenceList incidence_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-	: incidence_lists_(vertex_count) {
+	: offsets_(vertex_count + 1, 0) {
+}
+
+template <typename Weight>
+DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+	: edges_(std::move(edges))
+	, offsets_(vertex_count + 1, 0)
+{
+	CheckEdges(0);
+	BuildIncidence();
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::CheckEdges(EdgeId first_edge) const {
+	for (EdgeId id = first_edge; id < edges_.size(); ++id) {
+		if (edges_[id].from >= GetVertexCount() || edges_[id].to >= GetVertexCount()) {
+			throw std::out_of_range("Edge vertex id is out of range");
+		}
+	}
+}
+
+// Сортировка подсчетом сохраняет порядок добавления ребер внутри каждой вершины
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::BuildIncidence() {
+	const size_t vertex_count = GetVertexCount();
+	std::fill(offsets_.begin(), offsets_.end(), 0);
+	for (const auto& edge : edges_) {
+		++offsets_[edge.from + 1];
+	}
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		offsets_[vertex + 1] += offsets_[vertex];
+	}
+	incidence_.resize(edges_.size());
+	std::vector<size_t> positions(offsets_.begin(), offsets_.end() - 1);
+	for (EdgeId id = 0; id < edges_.size(); ++id) {
+		incidence_[positions[edges_[id].from]++] = id;
+	}
 }
 
 template <typename Weight>
-EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
-	edges_.push_back(edge);
-	const EdgeId id = edges_.size() - 1;
-	incidence_lists_.at(edge.from).push_back(id);
-	return id;
+void DirectedWeightedGraph<Weight>::AddVertices(size_t count) {
+	offsets_.resize(offsets_.size() + count, offsets_.back());
+}
+
+template <typename Weight>
+EdgeId DirectedWeightedGraph<Weight>::AddEdges(std::vector<Edge<Weight>> edges) {
+	const EdgeId first_edge = edges_.size();
+	edges_.insert(edges_.end(), edges.begin(), edges.end());
+	try {
+		CheckEdges(first_edge);
+	} catch (...) {
+		edges_.resize(first_edge);
+		throw;
+	}
+	BuildIncidence();
+	return first_edge;
+}
+
+template <typename Weight>
+template <typename Predicate>
+std::vector<std::optional<EdgeId>> DirectedWeightedGraph<Weight>::RemoveEdges(Predicate is_removed) {
+	std::vector<std::optional<EdgeId>> new_ids(edges_.size());
+	EdgeId next_id = 0;
+	for (EdgeId id = 0; id < edges_.size(); ++id) {
+		if (!is_removed(id)) {
+			new_ids[id] = next_id;
+			edges_[next_id++] = edges_[id];
+		}
+	}
+	edges_.resize(next_id);
+	BuildIncidence();
+	return new_ids;
 }
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-	return incidence_lists_.size();
+	return offsets_.size() - 1;
 }
 
 template <typename Weight>
@@ -66,9 +150,17 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 	return edges_.at(edge_id);
 }
 
+template <typename Weight>
+const std::vector<Edge<Weight>>& DirectedWeightedGraph<Weight>::GetEdges() const {
+	return edges_;
+}
+
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-	return ranges::AsRange(incidence_lists_.at(vertex));
+	if (vertex >= GetVertexCount()) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+	return {incidence_.begin() + offsets_[vertex], incidence_.begin() + offsets_[vertex + 1]};
 }
 }  // namespace graph
@@ -154,7 +154,7 @@ namespace transport::input {
 			for (auto & [other_name, distance] : stop_data.distances) {
 				auto stop_from = t.FindStop(stop_name);
 				auto stop_to = t.FindStop(other_name);
-				t.SetStopDistance(stop_from.value(), stop_to.value(), distance);
+				t.SetStopDistance(stop_from.value()->id, stop_to.value()->id, distance);
 			}
 		}
 
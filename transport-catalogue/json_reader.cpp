@@ -58,6 +58,16 @@ namespace transport::json_reader {
 					query.type = handler::QueryType::MAP;
 				} else if (request.AsDict().at("type"s).AsString() == "Route"s) {
 					query.type = handler::QueryType::ROUTE;
+				} else if (request.AsDict().at("type"s).AsString() == "RouteMatrix"s) {
+					query.type = handler::QueryType::ROUTE_MATRIX;
+				} else if (request.AsDict().at("type"s).AsString() == "Isochrone"s) {
+					query.type = handler::QueryType::ISOCHRONE;
+				} else if (request.AsDict().at("type"s).AsString() == "Segment"s) {
+					query.type = handler::QueryType::SEGMENT;
+				} else if (request.AsDict().at("type"s).AsString() == "Graph"s) {
+					query.type = handler::QueryType::GRAPH;
+				} else if (request.AsDict().at("type"s).AsString() == "RouteCache"s) {
+					query.type = handler::QueryType::ROUTE_CACHE;
 				} else {
 					continue;
 				}
@@ -65,11 +75,32 @@ namespace transport::json_reader {
 				if (request.AsDict().count("name"s)) {
 					query.name = request.AsDict().at("name"s).AsString();
 				}
-				if (request.AsDict().count("from"s)) {
-					query.from = request.AsDict().at("from"s).AsString();
-				}
-				if (request.AsDict().count("to"s)) {
-					query.to = request.AsDict().at("to"s).AsString();
+				if (query.type == handler::QueryType::ROUTE_MATRIX) {
+					for (auto & stop : request.AsDict().at("from"s).AsArray()) {
+						query.sources.push_back(stop.AsString());
+					}
+					for (auto & stop : request.AsDict().at("to"s).AsArray()) {
+						query.targets.push_back(stop.AsString());
+					}
+				} else {
+					if (request.AsDict().count("from"s)) {
+						query.from = request.AsDict().at("from"s).AsString();
+					}
+					if (request.AsDict().count("to"s)) {
+						query.to = request.AsDict().at("to"s).AsString();
+					}
+					if (request.AsDict().count("max_time"s)) {
+						query.max_time = request.AsDict().at("max_time"s).AsDouble();
+					}
+					if (request.AsDict().count("profile"s)) {
+						query.profile = request.AsDict().at("profile"s).AsString();
+					}
+					if (request.AsDict().count("bus_wait_time"s)) {
+						query.bus_wait_time = request.AsDict().at("bus_wait_time"s).AsInt();
+					}
+					if (request.AsDict().count("bus_velocity"s)) {
+						query.bus_velocity = request.AsDict().at("bus_velocity"s).AsDouble();
+					}
 				}
 				outputs.queries.push_back(std::move(query));
 			}
@@ -85,6 +116,56 @@ namespace transport::json_reader {
 			if (route_settings.count("bus_velocity"s)) {
 				router.settings.bus_velocity = route_settings.at("bus_velocity"s).AsDouble();
 			}
+			if (route_settings.count("routing_threads"s)) {
+				router.settings.threads = route_settings.at("routing_threads"s).AsInt();
+			}
+			if (route_settings.count("routing_landmarks"s)) {
+				router.settings.landmark_count = route_settings.at("routing_landmarks"s).AsInt();
+			}
+			if (route_settings.count("route_cache_size"s)) {
+				router.settings.route_cache_size = route_settings.at("route_cache_size"s).AsInt();
+			}
+			if (route_settings.count("profile_cache_size"s)) {
+				router.settings.profile_cache_size = route_settings.at("profile_cache_size"s).AsInt();
+			}
+			if (route_settings.count("profiles"s)) {
+				for (const auto & [name, profile] : route_settings.at("profiles"s).AsDict()) {
+					// Не заданные в профиле значения берутся из основных настроек. Профиль с нулевой
+					// или отрицательной скоростью либо отрицательным ожиданием не сохраняется, запросы с ним не находятся
+					TransportRouter::RoutingProfile result;
+					result.bus_wait_time = profile.AsDict().count("bus_wait_time"s)
+						? profile.AsDict().at("bus_wait_time"s).AsInt()
+						: router.settings.bus_wait_time;
+					result.bus_velocity = profile.AsDict().count("bus_velocity"s)
+						? profile.AsDict().at("bus_velocity"s).AsDouble()
+						: router.settings.bus_velocity;
+					if (result.bus_velocity > 0 && result.bus_wait_time >= 0) {
+						router.settings.profiles[name] = result;
+					}
+				}
+			}
+			if (route_settings.count("routing_graph"s)) {
+				const std::string& model = route_settings.at("routing_graph"s).AsString();
+				if (model == "linear"s) {
+					router.settings.graph_model = TransportRouter::GraphModel::LINEAR;
+				} else if (model == "stop_pairs"s) {
+					router.settings.graph_model = TransportRouter::GraphModel::STOP_PAIRS;
+				}
+			}
+			if (route_settings.count("routing_algorithm"s)) {
+				const std::string& algorithm = route_settings.at("routing_algorithm"s).AsString();
+				if (algorithm == "dijkstra"s) {
+					router.settings.strategy = graph::RouterStrategy::DIJKSTRA;
+				} else if (algorithm == "contraction_hierarchy"s) {
+					router.settings.strategy = graph::RouterStrategy::CONTRACTION_HIERARCHY;
+				} else if (algorithm == "a_star"s) {
+					router.settings.strategy = graph::RouterStrategy::A_STAR;
+				} else if (algorithm == "all_pairs"s) {
+					router.settings.strategy = graph::RouterStrategy::ALL_PAIRS;
+				} else if (algorithm == "raptor"s) {
+					router.settings.engine = TransportRouter::RouteEngine::RAPTOR;
+				}
+			}
 		}
 	}
 
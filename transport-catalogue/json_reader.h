@@ -96,6 +96,72 @@ namespace transport::json_reader {
 					.EndDict()
 					.Build().AsDict();
 			}
+			::json::Node operator()(TransportRouter::RouteMatrix matrix) const {
+				::json::Array rows;
+				for (size_t row_index = 0; row_index < matrix.rows; ++row_index) {
+					::json::Array row;
+					for (size_t i = row_index * matrix.columns; i < (row_index + 1) * matrix.columns; ++i) {
+						row.push_back(matrix.total_times[i].has_value()
+							? ::json::Node(*matrix.total_times[i])
+							: ::json::Node(nullptr));
+					}
+					rows.push_back(std::move(row));
+				}
+
+				return ::json::Builder{}
+					.StartDict()
+						.Key("request_id"s).Value(id)
+						.Key("total_times"s).Value(std::move(rows))
+					.EndDict()
+					.Build().AsDict();
+			}
+			::json::Node operator()(handler::SegmentInfo segment) const {
+				return ::json::Builder{}
+					.StartDict()
+						.Key("request_id"s).Value(id)
+						.Key("distance"s).Value(static_cast<double>(segment.distance))
+						.Key("time"s).Value(segment.time)
+						.Key("span_count"s).Value(segment.span_count)
+					.EndDict()
+					.Build().AsDict();
+			}
+			::json::Node operator()(TransportRouter::GraphStats stats) const {
+				return ::json::Builder{}
+					.StartDict()
+						.Key("request_id"s).Value(id)
+						.Key("vertex_count"s).Value(static_cast<int>(stats.vertex_count))
+						.Key("edge_count"s).Value(static_cast<int>(stats.edge_count))
+						.Key("dominated_edge_count"s).Value(static_cast<int>(stats.dominated_edge_count))
+					.EndDict()
+					.Build().AsDict();
+			}
+			::json::Node operator()(cache::CacheStats stats) const {
+				return ::json::Builder{}
+					.StartDict()
+						.Key("request_id"s).Value(id)
+						.Key("hits"s).Value(static_cast<int>(stats.hits))
+						.Key("misses"s).Value(static_cast<int>(stats.misses))
+					.EndDict()
+					.Build().AsDict();
+			}
+			::json::Node operator()(TransportRouter::Isochrone isochrone) const {
+				::json::Array items;
+				for (const auto & item : isochrone.items) {
+					items.push_back(::json::Builder{}
+						.StartDict()
+							.Key("stop_name"s).Value(std::string(item.stop_name))
+							.Key("time"s).Value(item.time)
+						.EndDict()
+						.Build());
+				}
+
+				return ::json::Builder{}
+					.StartDict()
+						.Key("request_id"s).Value(id)
+						.Key("items"s).Value(std::move(items))
+					.EndDict()
+					.Build().AsDict();
+			}
 		};
 	};
 }
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cache {
+
+struct CacheStats {
+	size_t hits = 0;
+	size_t misses = 0;
+};
+
+// Потокобезопасный кэш с вытеснением давно не использованных значений (LRU).
+// Ключи распределены по сегментам хэшем, у каждого сегмента свой мьютекс,
+// поэтому параллельные обращения к разным ключам почти не конкурируют
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache {
+public:
+	explicit ShardedLruCache(size_t capacity = 0, size_t shard_count = DEFAULT_SHARD_COUNT);
+
+	// Очищает кэш и задает новую емкость, 0 отключает кэширование
+	void Reset(size_t capacity);
+	void Clear();
+
+	std::optional<Value> Get(const Key& key);
+	void Put(const Key& key, Value value);
+
+	size_t GetCapacity() const;
+	CacheStats GetStats() const;
+
+private:
+	using Entries = std::list<std::pair<Key, Value>>;
+	struct Shard {
+		std::mutex mutex;
+		Entries entries; // в начале - последние использованные
+		std::unordered_map<Key, typename Entries::iterator, Hash> index;
+		size_t capacity = 0;
+	};
+
+	Shard& GetShard(const Key& key);
+
+	static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+	Hash hasher_;
+	size_t capacity_ = 0;
+	std::vector<Shard> shards_;
+	std::atomic<size_t> hits_ = 0;
+	std::atomic<size_t> misses_ = 0;
+};
+
+template <typename Key, typename Value, typename Hash>
+ShardedLruCache<Key, Value, Hash>::ShardedLruCache(size_t capacity, size_t shard_count)
+	: shards_(std::max<size_t>(shard_count, 1))
+{
+	Reset(capacity);
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedLruCache<Key, Value, Hash>::Reset(size_t capacity) {
+	capacity_ = capacity;
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		std::lock_guard guard(shards_[i].mutex);
+		// Емкость делится между сегментами поровну, остаток достается первым
+		shards_[i].capacity = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+		shards_[i].entries.clear();
+		shards_[i].index.clear();
+	}
+	hits_ = 0;
+	misses_ = 0;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedLruCache<Key, Value, Hash>::Clear() {
+	Reset(capacity_);
+}
+
+template <typename Key, typename Value, typename Hash>
+std::optional<Value> ShardedLruCache<Key, Value, Hash>::Get(const Key& key) {
+	Shard& shard = GetShard(key);
+	std::lock_guard guard(shard.mutex);
+	auto it = shard.index.find(key);
+	if (it == shard.index.end()) {
+		++misses_;
+		return std::nullopt;
+	}
+	++hits_;
+	shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+	return it->second->second;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ShardedLruCache<Key, Value, Hash>::Put(const Key& key, Value value) {
+	Shard& shard = GetShard(key);
+	std::lock_guard guard(shard.mutex);
+	// Емкость сегмента меняет Reset под тем же мьютексом
+	if (shard.capacity == 0) {
+		return;
+	}
+	if (auto it = shard.index.find(key); it != shard.index.end()) {
+		it->second->second = std::move(value);
+		shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+		return;
+	}
+	if (shard.entries.size() == shard.capacity) {
+		shard.index.erase(shard.entries.back().first);
+		shard.entries.pop_back();
+	}
+	shard.entries.emplace_front(key, std::move(value));
+	shard.index.emplace(key, shard.entries.begin());
+}
+
+template <typename Key, typename Value, typename Hash>
+size_t ShardedLruCache<Key, Value, Hash>::GetCapacity() const {
+	return capacity_;
+}
+
+template <typename Key, typename Value, typename Hash>
+CacheStats ShardedLruCache<Key, Value, Hash>::GetStats() const {
+	return {hits_.load(), misses_.load()};
+}
+
+template <typename Key, typename Value, typename Hash>
+typename ShardedLruCache<Key, Value, Hash>::Shard&
+ShardedLruCache<Key, Value, Hash>::GetShard(const Key& key) {
+	return shards_[hasher_(key) % shards_.size()];
+}
+
+}  // namespace cache
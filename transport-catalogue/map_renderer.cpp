@@ -46,13 +46,13 @@ namespace transport::renderer {
 		container.Add(path_);
 	}
 
-	Label& Label::SetText(std::string text, int font_size, bool has_font_weight) {
+	Label& Label::SetText(std::string_view text, int font_size, bool has_font_weight) {
 		back_.SetFontSize(font_size)
-			.SetData(text)
+			.SetData(std::string(text))
 			.SetFontFamily("Verdana");
 
 		front_.SetFontSize(font_size)
-			.SetData(text)
+			.SetData(std::string(text))
 			.SetFontFamily("Verdana");
 
 		if (has_font_weight) {
@@ -105,31 +105,35 @@ namespace transport::renderer {
 		settings_ = std::move(settings);
 	}
 
-	void MapRenderer::Print(std::vector<domain::BusPtr> && buses, std::ostringstream & str) const {
+	void MapRenderer::Print(std::vector<domain::BusPtr> && buses, const std::vector<domain::StopPtr> & stops,
+		std::ostringstream & str) const
+	{
 		std::sort(buses.begin(), buses.end(), [](auto lhs, auto rhs){
 			return lhs->name < rhs->name;
 		});
-		SphereProjector proj = MakeProjector(buses);
+		SphereProjector proj = MakeProjector(buses, stops);
 
-		std::vector<DrawPtr> routes = std::move(MakeDrawableRoutes(proj, buses));
-		std::vector<DrawPtr> route_names = std::move(MakeDrawableRouteNames(proj, buses));
-		std::map<std::string_view, DrawPtr> stops = std::move(MakeDrawableStops(proj, buses));
-		std::map<std::string_view, DrawPtr> stop_names = std::move(MakeDrawableStopNames(proj, buses));
+		std::vector<DrawPtr> routes = std::move(MakeDrawableRoutes(proj, buses, stops));
+		std::vector<DrawPtr> route_names = std::move(MakeDrawableRouteNames(proj, buses, stops));
+		std::map<std::string_view, DrawPtr> stop_points = std::move(MakeDrawableStops(proj, buses, stops));
+		std::map<std::string_view, DrawPtr> stop_names = std::move(MakeDrawableStopNames(proj, buses, stops));
 
 		svg::Document doc;
 		detail::DrawLayer(routes, doc);
 		detail::DrawLayer(route_names, doc);
-		detail::DrawLayer(stops, doc);
+		detail::DrawLayer(stop_points, doc);
 		detail::DrawLayer(stop_names, doc);
 		doc.Render(str);
 	}
 
 	// Принадлежит классу, т.к. использует приватный параметр settings
-	SphereProjector MapRenderer::MakeProjector(const std::vector<domain::BusPtr> & buses) const {
+	SphereProjector MapRenderer::MakeProjector(const std::vector<domain::BusPtr> & buses,
+		const std::vector<domain::StopPtr> & stops) const
+	{
 		std::vector<geo::Coordinates> geo_coords;
 		for (auto bus : buses) {
-			for (auto stop : bus->stops) {
-				geo_coords.push_back(stop->coordinates);
+			for (domain::StopId stop : bus->stops) {
+				geo_coords.push_back(stops[stop]->coordinates);
 			}
 		}
 
@@ -140,7 +144,7 @@ namespace transport::renderer {
 
 	std::vector<MapRenderer::DrawPtr> MapRenderer::MakeDrawableRoutes (
 		const SphereProjector & proj,
-		const std::vector<domain::BusPtr> & buses) const
+		const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const
 	{
 		std::vector<DrawPtr> routes;
 		int current_color_num = 0;
@@ -148,8 +152,8 @@ namespace transport::renderer {
 		for (auto bus : buses) {
 			Route r;
 			r.SetPathProperties(settings_.line_width, settings_.color_palette.at(current_color_num));
-			for (auto stop : bus->stops) {
-				r.AddStop(proj(stop->coordinates));
+			for (domain::StopId stop : bus->GetRouteStops()) {
+				r.AddStop(proj(stops[stop]->coordinates));
 			}
 			if (!bus->stops.empty()) {
 				++current_color_num;
@@ -163,7 +167,7 @@ namespace transport::renderer {
 
 	std::vector<MapRenderer::DrawPtr> MapRenderer::MakeDrawableRouteNames(
 		const SphereProjector & proj,
-		const std::vector<domain::BusPtr> & buses) const
+		const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const
 	{
 		std::vector<DrawPtr> route_names;
 		int current_color_num = 0;
@@ -174,14 +178,14 @@ namespace transport::renderer {
 				label.SetText(bus->name, settings_.bus_label_font_size, true)
 					.SetGraphic(settings_.underlayer_width, settings_.underlayer_color,
 						settings_.color_palette.at(current_color_num))
-					.SetPosition(proj(bus->start->coordinates),
+					.SetPosition(proj(stops[bus->start]->coordinates),
 						settings_.bus_label_offset);
 				route_names.push_back(std::make_unique<Label>(label));
 
 				if (bus->start != bus->finish) {
 					// Если начальная и конечная остановки не совпадают
 					// Добавляем еще одну точку
-					label.SetPosition(proj(bus->finish->coordinates),
+					label.SetPosition(proj(stops[bus->finish]->coordinates),
 						settings_.bus_label_offset);
 					route_names.push_back(std::make_unique<Label>(label));
 				}
@@ -196,29 +200,31 @@ namespace transport::renderer {
 
 	std::map<std::string_view, MapRenderer::DrawPtr> MapRenderer::MakeDrawableStops(
 		const SphereProjector & proj,
-		const std::vector<domain::BusPtr> & buses) const
+		const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const
 	{
-		std::map<std::string_view, DrawPtr> stops;
+		std::map<std::string_view, DrawPtr> stop_points;
 
 		for (auto bus : buses) {
-			for (auto stop : bus->stops) {
+			for (domain::StopId stop_id : bus->stops) {
+				domain::StopPtr stop = stops[stop_id];
 				StopPoint sp;
 				sp.SetProperties(proj(stop->coordinates), settings_.stop_radius);
-				stops.emplace(stop->name, std::make_unique<StopPoint>(sp));
+				stop_points.emplace(stop->name, std::make_unique<StopPoint>(sp));
 			}
 		}
 
-		return stops;
+		return stop_points;
 	}
 
 	std::map<std::string_view, MapRenderer::DrawPtr> MapRenderer::MakeDrawableStopNames(
 		const SphereProjector & proj,
-		const std::vector<domain::BusPtr> & buses) const
+		const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const
 	{
 		std::map<std::string_view, DrawPtr> stop_names;
 
 		for (auto bus : buses) {
-			for (auto stop : bus->stops) {
+			for (domain::StopId stop_id : bus->stops) {
+				domain::StopPtr stop = stops[stop_id];
 				Label label;
 				label.SetText(stop->name, settings_.stop_label_font_size)
 					.SetGraphic(settings_.underlayer_width,
@@ -61,7 +61,7 @@ namespace transport::renderer {
 
 	class Label : public svg::Drawable {
 	public:
-		Label& SetText(std::string text, int font_size, bool has_font_weight = false);
+		Label& SetText(std::string_view text, int font_size, bool has_font_weight = false);
 		Label& SetGraphic(double stroke_width, svg::Color back, svg::Color front = "black");
 		Label& SetPosition(svg::Point coordinates, svg::Point offset);
 		void Draw(svg::ObjectContainer & container) const override;
@@ -80,25 +80,28 @@ namespace transport::renderer {
 	class MapRenderer {
 	public:
 		void SetSettings(Settings settings);
-		void Print(std::vector<domain::BusPtr> && buses, std::ostringstream & str) const;
+		// stops - все остановки, ключ - индекс остановки
+		void Print(std::vector<domain::BusPtr> && buses, const std::vector<domain::StopPtr> & stops,
+			std::ostringstream & str) const;
 	private:
 		Settings settings_;
 
 		using DrawPtr = std::unique_ptr<svg::Drawable>;
 
-		SphereProjector MakeProjector(const std::vector<domain::BusPtr> & buses) const;
+		SphereProjector MakeProjector(const std::vector<domain::BusPtr> & buses,
+			const std::vector<domain::StopPtr> & stops) const;
 
 		std::vector<DrawPtr> MakeDrawableRoutes(const SphereProjector & proj,
-			const std::vector<domain::BusPtr> & buses) const;
+			const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const;
 
 		std::vector<DrawPtr> MakeDrawableRouteNames(const SphereProjector & proj,
-			const std::vector<domain::BusPtr> & buses) const;
+			const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const;
 
 		std::map<std::string_view, DrawPtr> MakeDrawableStops(const SphereProjector & proj,
-			const std::vector<domain::BusPtr> & buses) const;
+			const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const;
 
 		std::map<std::string_view, DrawPtr> MakeDrawableStopNames(const SphereProjector & proj,
-			const std::vector<domain::BusPtr> & buses) const;
+			const std::vector<domain::BusPtr> & buses, const std::vector<domain::StopPtr> & stops) const;
 	};
 
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Векторная версия собирается только для x86 компиляторами с атрибутом target,
+// остальные сборки используют скалярный цикл
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GRAPH_MIN_PLUS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace graph::detail {
+
+// Шаг (min, +) для строки таблицы маршрутов: маршрут в каждую вершину to заменяется маршрутом
+// через промежуточную вершину, если тот короче. weight_from и prev_edge_from - вес и последнее ребро
+// маршрута до промежуточной вершины, through_* - строка промежуточной вершины.
+// Последнее ребро пути равно no_edge только у пути из вершины в себя, тогда последним становится prev_edge_from
+template <typename Weight>
+void RelaxRouteRowScalar(Weight* row_weights, uint32_t* row_prev_edges, Weight weight_from, uint32_t prev_edge_from,
+	const Weight* through_weights, const uint32_t* through_prev_edges, size_t count, uint32_t no_edge)
+{
+	for (size_t to = 0; to < count; ++to) {
+		const Weight candidate_weight = weight_from + through_weights[to];
+		if (candidate_weight < row_weights[to]) {
+			row_weights[to] = candidate_weight;
+			row_prev_edges[to] = through_prev_edges[to] != no_edge ? through_prev_edges[to] : prev_edge_from;
+		}
+	}
+}
+
+#ifdef GRAPH_MIN_PLUS_AVX2
+// Четыре веса за шаг. Сложение и сравнение те же, что и в скалярном цикле, поэтому результат совпадает
+// побитово. Маска сравнения 64-битных весов сжимается до 32-битных ячеек последних ребер
+__attribute__((target("avx2")))
+inline void RelaxRouteRowAvx2(double* row_weights, uint32_t* row_prev_edges, double weight_from,
+	uint32_t prev_edge_from, const double* through_weights, const uint32_t* through_prev_edges, size_t count,
+	uint32_t no_edge)
+{
+	const __m256d from = _mm256_set1_pd(weight_from);
+	const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+	const __m128i no_edges = _mm_set1_epi32(static_cast<int>(no_edge));
+	const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	size_t to = 0;
+	for (; to + 4 <= count; to += 4) {
+		const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(through_weights + to));
+		const __m256d current = _mm256_loadu_pd(row_weights + to);
+		const __m256d is_shorter = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+		if (_mm256_movemask_pd(is_shorter) == 0) {
+			continue;
+		}
+		_mm256_storeu_pd(row_weights + to, _mm256_blendv_pd(current, candidate, is_shorter));
+
+		const __m128i mask = _mm256_castsi256_si128(
+			_mm256_permutevar8x32_epi32(_mm256_castpd_si256(is_shorter), low_halves));
+		const __m128i through_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(through_prev_edges + to));
+		const __m128i candidate_prev = _mm_blendv_epi8(through_prev, prev_from, _mm_cmpeq_epi32(through_prev, no_edges));
+		__m128i* prev_edges = reinterpret_cast<__m128i*>(row_prev_edges + to);
+		_mm_storeu_si128(prev_edges, _mm_blendv_epi8(_mm_loadu_si128(prev_edges), candidate_prev, mask));
+	}
+	RelaxRouteRowScalar(row_weights + to, row_prev_edges + to, weight_from, prev_edge_from,
+		through_weights + to, through_prev_edges + to, count - to, no_edge);
+}
+
+inline bool HasAvx2() {
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+}
+#endif
+
+template <typename Weight>
+void RelaxRouteRow(Weight* row_weights, uint32_t* row_prev_edges, Weight weight_from, uint32_t prev_edge_from,
+	const Weight* through_weights, const uint32_t* through_prev_edges, size_t count, uint32_t no_edge)
+{
+	RelaxRouteRowScalar(row_weights, row_prev_edges, weight_from, prev_edge_from,
+		through_weights, through_prev_edges, count, no_edge);
+}
+
+// Набор инструкций выбирается при выполнении: без AVX2 работает скалярный цикл
+inline void RelaxRouteRow(double* row_weights, uint32_t* row_prev_edges, double weight_from, uint32_t prev_edge_from,
+	const double* through_weights, const uint32_t* through_prev_edges, size_t count, uint32_t no_edge)
+{
+#ifdef GRAPH_MIN_PLUS_AVX2
+	if (HasAvx2()) {
+		RelaxRouteRowAvx2(row_weights, row_prev_edges, weight_from, prev_edge_from,
+			through_weights, through_prev_edges, count, no_edge);
+		return;
+	}
+#endif
+	RelaxRouteRowScalar(row_weights, row_prev_edges, weight_from, prev_edge_from,
+		through_weights, through_prev_edges, count, no_edge);
+}
+
+}  // namespace graph::detail
@@ -0,0 +1,261 @@
+#include "raptor.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace transport {
+	namespace {
+		constexpr double INFINITE_TIME = std::numeric_limits<double>::infinity();
+	}
+
+	Raptor::Raptor(const TransportCatalogue & catalogue, double bus_wait_time, double bus_velocity)
+		: bus_wait_time_(bus_wait_time)
+		, bus_velocity_(bus_velocity)
+	{
+		// Индексы остановок идут в порядке справочника, как и вершины графа
+		std::vector<domain::BusPtr> buses;
+		stop_ids_.assign(catalogue.GetStopCount(), NO_STOP);
+		for (domain::BusPtr bus : catalogue.GetAllRoutes()) {
+			if (bus->stops.size() < 2) {
+				continue;
+			}
+			buses.push_back(bus);
+			for (domain::StopId stop : bus->stops) {
+				stop_ids_[stop] = 0;
+			}
+		}
+		for (domain::StopId stop = 0; stop < stop_ids_.size(); ++stop) {
+			if (stop_ids_[stop] != NO_STOP) {
+				stop_ids_[stop] = static_cast<uint32_t>(stop_names_.size());
+				stop_names_.push_back(catalogue.GetStop(stop)->name);
+			}
+		}
+
+		for (domain::BusPtr bus : buses) {
+			const domain::RouteStops route = bus->GetRouteStops();
+			Line line{bus, {}};
+			line.stops.reserve(route.size());
+			for (domain::StopId stop : route) {
+				line.stops.push_back(stop_ids_[stop]);
+			}
+			lines_.push_back(std::move(line));
+		}
+
+		stop_lines_offsets_.assign(stop_names_.size() + 1, 0);
+		for (const Line & line : lines_) {
+			for (uint32_t stop : line.stops) {
+				++stop_lines_offsets_[stop + 1];
+			}
+		}
+		for (size_t stop = 0; stop < stop_names_.size(); ++stop) {
+			stop_lines_offsets_[stop + 1] += stop_lines_offsets_[stop];
+		}
+		stop_lines_.resize(stop_lines_offsets_.back());
+		std::vector<size_t> positions(stop_lines_offsets_.begin(), stop_lines_offsets_.end() - 1);
+		for (size_t line_id = 0; line_id < lines_.size(); ++line_id) {
+			const Line & line = lines_[line_id];
+			for (size_t i = 0; i < line.stops.size(); ++i) {
+				stop_lines_[positions[line.stops[i]]++] = {static_cast<uint32_t>(line_id), static_cast<uint32_t>(i)};
+			}
+		}
+	}
+
+	void Raptor::SetProfile(double bus_wait_time, double bus_velocity) {
+		bus_wait_time_ = bus_wait_time;
+		bus_velocity_ = bus_velocity;
+	}
+
+	std::optional<size_t> Raptor::FindStop(domain::StopId stop) const {
+		if (stop >= stop_ids_.size() || stop_ids_[stop] == NO_STOP) {
+			return std::nullopt;
+		}
+		return stop_ids_[stop];
+	}
+
+	size_t Raptor::GetStopCount() const {
+		return stop_names_.size();
+	}
+
+	std::string_view Raptor::GetStopName(size_t stop) const {
+		return stop_names_.at(stop);
+	}
+
+	// Порядок операций тот же, что и у веса ребра графа с добавлением к времени прибытия,
+	// поэтому результат совпадает с поиском по графу
+	double Raptor::GetRideTime(const Line & line, size_t board, size_t alight) const {
+		return 1.0 * (line.bus->distances[alight] - line.bus->distances[board]) / bus_velocity_ + bus_wait_time_;
+	}
+
+	Raptor::SearchData & Raptor::GetSearchData() const {
+		thread_local SearchData data;
+		const size_t stop_count = stop_names_.size();
+		if (data.search_ids.size() < stop_count) {
+			data.search_ids.resize(stop_count, 0);
+			data.last_labels.resize(stop_count);
+			data.round_start_times.resize(stop_count);
+			data.is_marked.resize(stop_count, false);
+		}
+		if (data.line_starts.size() < lines_.size()) {
+			data.line_starts.resize(lines_.size(), NO_LINE);
+		}
+		if (++data.search_id == 0) {
+			// Счетчик переполнился - старые метки могут совпасть с новыми
+			std::fill(data.search_ids.begin(), data.search_ids.end(), 0);
+			data.search_id = 1;
+		}
+		data.labels.clear();
+		data.reached_stops.clear();
+		return data;
+	}
+
+	void Raptor::Run(size_t from, std::optional<size_t> to, double max_time, SearchData & data) const {
+		const auto get_best_time = [&data](size_t stop) {
+			return data.search_ids[stop] == data.search_id ? data.labels[data.last_labels[stop]].time : INFINITE_TIME;
+		};
+		// Время раунда round - 1: улучшения текущего раунда для посадки не учитываются
+		const auto get_previous_time = [&data](size_t stop, uint32_t round) {
+			if (data.search_ids[stop] != data.search_id) {
+				return INFINITE_TIME;
+			}
+			const Label & label = data.labels[data.last_labels[stop]];
+			return label.round < round ? label.time : data.round_start_times[stop];
+		};
+		const auto add_label = [&data](size_t stop, Label label) {
+			if (data.search_ids[stop] != data.search_id) {
+				data.search_ids[stop] = data.search_id;
+				data.last_labels[stop] = NO_LABEL;
+				data.round_start_times[stop] = INFINITE_TIME;
+				data.reached_stops.push_back(static_cast<uint32_t>(stop));
+			} else if (data.labels[data.last_labels[stop]].round < label.round) {
+				data.round_start_times[stop] = data.labels[data.last_labels[stop]].time;
+			}
+			label.previous = data.last_labels[stop];
+			data.last_labels[stop] = static_cast<uint32_t>(data.labels.size());
+			data.labels.push_back(label);
+		};
+
+		add_label(from, Label{0, 0, NO_LINE, 0, 0, NO_LABEL});
+		data.marked_stops.assign(1, static_cast<uint32_t>(from));
+		for (uint32_t round = 1; !data.marked_stops.empty(); ++round) {
+			for (uint32_t stop : data.marked_stops) {
+				for (size_t i = stop_lines_offsets_[stop]; i < stop_lines_offsets_[stop + 1]; ++i) {
+					const auto [line_id, position] = stop_lines_[i];
+					if (data.line_starts[line_id] == NO_LINE) {
+						data.queued_lines.push_back(line_id);
+						data.line_starts[line_id] = position;
+					} else {
+						data.line_starts[line_id] = std::min(data.line_starts[line_id], position);
+					}
+				}
+				data.is_marked[stop] = false;
+			}
+			data.marked_stops.clear();
+
+			for (uint32_t line_id : data.queued_lines) {
+				const Line & line = lines_[line_id];
+				std::optional<size_t> board;
+				double board_time = INFINITE_TIME;
+				for (size_t position = data.line_starts[line_id]; position < line.stops.size(); ++position) {
+					const uint32_t stop = line.stops[position];
+					double arrival = INFINITE_TIME;
+					if (board) {
+						arrival = board_time + GetRideTime(line, *board, position);
+						// Прибытие позже уже известного до этой остановки или до цели ничего не улучшит
+						const double bound = to ? std::min(get_best_time(stop), get_best_time(*to)) : get_best_time(stop);
+						if (arrival < bound && arrival <= max_time) {
+							add_label(stop, Label{arrival, round, line_id, static_cast<uint32_t>(*board),
+								static_cast<uint32_t>(position), NO_LABEL});
+							if (!data.is_marked[stop]) {
+								data.is_marked[stop] = true;
+								data.marked_stops.push_back(stop);
+							}
+						}
+					}
+					// Пересесть на этот автобус здесь выгоднее, если успеваем дождаться его раньше,
+					// чем подъедем на нем с прежней остановки посадки
+					const double previous_time = get_previous_time(stop, round);
+					if (previous_time != INFINITE_TIME && (!board || previous_time + bus_wait_time_ < arrival)) {
+						board = position;
+						board_time = previous_time;
+					}
+				}
+				data.line_starts[line_id] = NO_LINE;
+			}
+			data.queued_lines.clear();
+		}
+	}
+
+	std::optional<Raptor::Journey> Raptor::BuildJourney(size_t from, size_t to) const {
+		const size_t stop_count = stop_names_.size();
+		if (from >= stop_count || to >= stop_count) {
+			throw std::out_of_range("Stop id is out of range");
+		}
+		SearchData & data = GetSearchData();
+		Run(from, to, INFINITE_TIME, data);
+		return ExtractJourney(data, from, to);
+	}
+
+	// Для нескольких целей поиск не отсекается по времени до цели и проходит все раунды
+	std::vector<std::optional<Raptor::Journey>> Raptor::BuildJourneys(size_t from,
+		const std::vector<size_t> & targets) const
+	{
+		const size_t stop_count = stop_names_.size();
+		if (from >= stop_count || std::any_of(targets.begin(), targets.end(), [stop_count](size_t stop) {
+			return stop >= stop_count;
+		})) {
+			throw std::out_of_range("Stop id is out of range");
+		}
+		if (targets.size() == 1) {
+			return {BuildJourney(from, targets.front())};
+		}
+		SearchData & data = GetSearchData();
+		Run(from, std::nullopt, INFINITE_TIME, data);
+		std::vector<std::optional<Journey>> result;
+		result.reserve(targets.size());
+		for (size_t to : targets) {
+			result.push_back(ExtractJourney(data, from, to));
+		}
+		return result;
+	}
+
+	// Последняя метка остановки - лучшее время, а ее раунд - первый раунд с этим временем,
+	// то есть путь с наименьшим числом пересадок. Остановка посадки берется с меткой предыдущего раунда
+	std::optional<Raptor::Journey> Raptor::ExtractJourney(const SearchData & data, size_t from, size_t to) const {
+		if (data.search_ids[to] != data.search_id) {
+			return std::nullopt;
+		}
+		Journey result{data.labels[data.last_labels[to]].time, {}};
+		uint32_t round = data.labels[data.last_labels[to]].round;
+		size_t stop = to;
+		while (stop != from) {
+			uint32_t label_id = data.last_labels[stop];
+			while (data.labels[label_id].round > round) {
+				label_id = data.labels[label_id].previous;
+			}
+			const Label & label = data.labels[label_id];
+			const Line & line = lines_[label.line];
+			stop = line.stops[label.board];
+			result.legs.push_back({line.bus, stop_names_[stop], label.board, label.alight,
+				GetRideTime(line, label.board, label.alight)});
+			round = label.round - 1;
+		}
+		std::reverse(result.legs.begin(), result.legs.end());
+		return result;
+	}
+
+	std::vector<std::optional<double>> Raptor::ComputeTimes(size_t from, double max_time) const {
+		const size_t stop_count = stop_names_.size();
+		if (from >= stop_count) {
+			throw std::out_of_range("Stop id is out of range");
+		}
+		SearchData & data = GetSearchData();
+		Run(from, std::nullopt, max_time, data);
+
+		std::vector<std::optional<double>> result(stop_count);
+		for (uint32_t stop : data.reached_stops) {
+			result[stop] = data.labels[data.last_labels[stop]].time;
+		}
+		return result;
+	}
+}
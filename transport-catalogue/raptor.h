@@ -0,0 +1,102 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace transport {
+	// Поиск маршрутов по раундам (RAPTOR) прямо по маршрутам автобусов, без построения графа.
+	// Раунд k находит лучшее время прибытия на каждую остановку не более чем с k посадками:
+	// просматриваются только маршруты, проходящие через остановки, улучшенные в раунде k - 1.
+	// Ожидание перед каждой посадкой постоянно, скорость всех автобусов одинакова
+	class Raptor {
+	public:
+		// Поездка на автобусе bus от остановки с индексом board до остановки alight в bus->GetRouteStops(),
+		// time - ожидание и время в пути
+		struct Leg {
+			domain::BusPtr bus;
+			std::string_view board_stop_name;
+			size_t board;
+			size_t alight;
+			double time;
+		};
+		struct Journey {
+			double total_time;
+			std::vector<Leg> legs;
+		};
+
+		// bus_wait_time - минуты, bus_velocity - метры в минуту
+		Raptor(const TransportCatalogue & catalogue, double bus_wait_time, double bus_velocity);
+
+		// Остановки, через которые не проходит ни один маршрут хотя бы из двух остановок, не индексируются
+		// Меняет время ожидания и скорость без перестроения индекса
+		void SetProfile(double bus_wait_time, double bus_velocity);
+
+		// Индекс остановки справочника, nullopt - через остановку не проходит ни один маршрут
+		std::optional<size_t> FindStop(domain::StopId stop) const;
+		size_t GetStopCount() const;
+		std::string_view GetStopName(size_t stop) const;
+
+		std::optional<Journey> BuildJourney(size_t from, size_t to) const;
+		// Поездки из from до каждой остановки targets за один поиск, ключ - индекс в targets
+		std::vector<std::optional<Journey>> BuildJourneys(size_t from, const std::vector<size_t> & targets) const;
+		// Время в пути из from до каждой остановки, ключ - индекс остановки. Остановки дальше max_time
+		// не достигаются: прибытия позже бюджета отбрасываются и не порождают новых раундов
+		std::vector<std::optional<double>> ComputeTimes(size_t from,
+			double max_time = std::numeric_limits<double>::infinity()) const;
+
+	private:
+		struct Line {
+			domain::BusPtr bus;
+			std::vector<uint32_t> stops; // расстояния до остановок - в bus->distances
+		};
+		// Улучшение времени прибытия на остановку в раунде round поездкой line от позиции board до alight.
+		// Метки остановки связаны в список от последней к первой, время в нем убывает
+		struct Label {
+			double time;
+			uint32_t round;
+			uint32_t line;
+			uint32_t board;
+			uint32_t alight;
+			uint32_t previous; // предыдущая метка той же остановки, NO_LABEL - нет
+		};
+		// Буферы поиска переиспользуются между запросами одного потока, как у поиска по графу.
+		// Остановка достигнута текущим поиском, если ее метка search_ids совпадает с search_id.
+		// is_marked и line_starts после каждого раунда возвращаются в исходное состояние
+		struct SearchData {
+			std::vector<uint32_t> search_ids;
+			uint32_t search_id = 0;
+			std::vector<uint32_t> last_labels; // ключ - остановка
+			std::vector<double> round_start_times; // время до улучшений текущего раунда, ключ - остановка
+			std::vector<Label> labels;
+			std::vector<uint32_t> reached_stops;
+			std::vector<bool> is_marked;
+			std::vector<uint32_t> marked_stops;
+			// Самая ранняя позиция на маршруте среди улучшенных остановок, NO_LINE - маршрут не просматривается
+			std::vector<uint32_t> line_starts;
+			std::vector<uint32_t> queued_lines;
+		};
+
+		SearchData & GetSearchData() const;
+		void Run(size_t from, std::optional<size_t> to, double max_time, SearchData & data) const;
+		std::optional<Journey> ExtractJourney(const SearchData & data, size_t from, size_t to) const;
+		double GetRideTime(const Line & line, size_t board, size_t alight) const;
+
+		static constexpr uint32_t NO_LINE = UINT32_MAX;
+		static constexpr uint32_t NO_STOP = UINT32_MAX;
+		static constexpr uint32_t NO_LABEL = UINT32_MAX;
+
+		double bus_wait_time_;
+		double bus_velocity_;
+		std::vector<Line> lines_;
+		std::vector<uint32_t> stop_ids_; // ключ - индекс остановки в справочнике, NO_STOP - нет индекса
+		std::vector<std::string_view> stop_names_; // ключ - индекс остановки
+		// Маршруты через каждую остановку: пары (маршрут, позиция на маршруте), начало для остановки - в offsets
+		std::vector<size_t> stop_lines_offsets_;
+		std::vector<std::pair<uint32_t, uint32_t>> stop_lines_;
+	};
+}
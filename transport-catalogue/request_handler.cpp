@@ -1,7 +1,10 @@
 #include "request_handler.h"
 #include "serialization.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <tuple>
 
 namespace transport::handler {
 	RequestHandler::RequestHandler(InputOutput* io)
@@ -10,7 +13,8 @@ namespace transport::handler {
 	void RequestHandler::MakeBase() {
 		auto queries = io_->Read();
 		FillTransportCatalogue( queries.inputs);
-		serialization::Serialize(queries.data_base.file_name, tc_, queries);
+		router_.Init(queries.router.settings, tc_);
+		serialization::Serialize(queries.data_base.file_name, tc_, router_, queries);
 	}
 
 	void RequestHandler::ProcessRequests() {
@@ -20,7 +24,13 @@ namespace transport::handler {
 		if (settings.has_value()) {
 			renderer_.SetSettings(settings->render_settings);
 			FillTransportCatalogue(settings->inputs);
-			router_.Init(settings->router.settings, tc_);
+			if (settings->router.graph.has_value()) {
+				router_.Init(settings->router.settings, MakeRouterGraph(*settings->router.graph),
+					std::move(settings->router.graph->precomputed));
+			} else {
+				router_.Init(settings->router.settings, tc_);
+			}
+			UpdateTransportCatalogue(queries.inputs);
 
 			auto printable_result = GetTransportData(queries.outputs);
 			io_->Write(printable_result);
@@ -31,31 +41,253 @@ namespace transport::handler {
 	std::string RequestHandler::GenerateMap() {
 		auto buses = tc_.GetAllRoutes();
 		std::ostringstream out;
-		renderer_.Print(std::move(buses), out);
+		renderer_.Print(std::move(buses), tc_.GetAllStops(), out);
 		return out.str();
 	}
 
+	// Остановки добавляются в порядке кривой Гильберта по координатам, поэтому соседние остановки
+	// получают близкие индексы в справочнике, а с ними и вершины графа. Порядок зависит только
+	// от названий и координат, так что process_requests восстанавливает тот же порядок, что и make_base
 	void RequestHandler::FillTransportCatalogue(const InputGroup & inputs) {
-		for (auto & [stop_name, stop_data] : inputs.stops) {
-			tc_.AddStop(stop_name, stop_data.coordinates);
+		std::vector<std::pair<uint64_t, std::string_view>> stops_order;
+		if (!inputs.stops.empty()) {
+			geo::Coordinates min = inputs.stops.begin()->second.coordinates;
+			geo::Coordinates max = min;
+			for (auto & [stop_name, stop_data] : inputs.stops) {
+				min = {std::min(min.lat, stop_data.coordinates.lat), std::min(min.lng, stop_data.coordinates.lng)};
+				max = {std::max(max.lat, stop_data.coordinates.lat), std::max(max.lng, stop_data.coordinates.lng)};
+			}
+			stops_order.reserve(inputs.stops.size());
+			for (auto & [stop_name, stop_data] : inputs.stops) {
+				stops_order.emplace_back(geo::ComputeHilbertIndex(stop_data.coordinates, min, max), stop_name);
+			}
+			std::sort(stops_order.begin(), stops_order.end());
+		}
+		for (auto & [hilbert_index, stop_name] : stops_order) {
+			tc_.AddStop(stop_name, inputs.stops.at(std::string(stop_name)).coordinates);
 		}
 
 		for (auto & [stop_name, stop_data] : inputs.stops) {
 			for (auto & [other_name, distance] : stop_data.distances) {
 				auto stop_from = tc_.FindStop(stop_name);
 				auto stop_to = tc_.FindStop(other_name);
-				tc_.SetStopDistance(stop_from.value(), stop_to.value(), distance);
+				tc_.SetStopDistance(stop_from.value()->id, stop_to.value()->id, distance);
 			}
 		}
 
 		for (auto & [bus_name, route] : inputs.buses) {
 			tc_.AddRoute(bus_name, route.stops, route.is_looped);
+			if (route.info.has_value()) {
+				tc_.SetRouteInfo(tc_.FindRoute(bus_name).value(), *route.info);
+			}
+		}
+		tc_.ComputeRouteInfos();
+	}
+
+	// Изменения поверх загруженной базы. Новые остановки добавляются вместе с расстояниями от них,
+	// у известных остановок координаты и расстояния не меняются: от них зависят остальные маршруты.
+	// Маршрут с известным названием заменяется. Граф и маршрутизатор обновляются частично
+	void RequestHandler::UpdateTransportCatalogue(const InputGroup & inputs) {
+		if (inputs.stops.empty() && inputs.buses.empty()) {
+			return;
+		}
+		// Порядок обхода unordered_map не определен, а от порядка добавления зависят индексы остановок
+		std::vector<std::string_view> new_stops;
+		for (auto & [stop_name, stop_data] : inputs.stops) {
+			if (!tc_.FindStop(stop_name).has_value()) {
+				new_stops.push_back(stop_name);
+			}
+		}
+		std::sort(new_stops.begin(), new_stops.end());
+		for (std::string_view stop_name : new_stops) {
+			tc_.AddStop(stop_name, inputs.stops.at(std::string(stop_name)).coordinates);
+		}
+		for (std::string_view stop_name : new_stops) {
+			for (auto & [other_name, distance] : inputs.stops.at(std::string(stop_name)).distances) {
+				auto stop_from = tc_.FindStop(stop_name);
+				auto stop_to = tc_.FindStop(other_name);
+				tc_.SetStopDistance(stop_from.value()->id, stop_to.value()->id, distance);
+			}
+		}
+
+		std::vector<std::string_view> bus_names;
+		for (auto & [bus_name, route] : inputs.buses) {
+			bus_names.push_back(bus_name);
+		}
+		std::sort(bus_names.begin(), bus_names.end());
+		for (std::string_view bus_name : bus_names) {
+			const Route & route = inputs.buses.at(std::string(bus_name));
+			if (tc_.FindRoute(bus_name).has_value()) {
+				tc_.RemoveRoute(bus_name);
+				router_.RemoveBus(tc_, bus_name);
+			}
+			tc_.AddRoute(bus_name, route.stops, route.is_looped);
+			router_.AddBus(tc_, bus_name);
+		}
+		tc_.ComputeRouteInfos();
+	}
+
+	TransportRouter::GraphData RequestHandler::MakeRouterGraph(const RouteGraph & route_graph) const {
+		TransportRouter::GraphData result;
+		result.vertices.reserve(route_graph.vertices.size());
+		result.coordinates.reserve(route_graph.vertices.size());
+		result.stops.reserve(route_graph.vertices.size());
+		for (auto & stop_name : route_graph.vertices) {
+			auto stop = tc_.FindStop(stop_name);
+			result.vertices.push_back(stop.has_value() ? std::string_view(stop.value()->name) : std::string_view{});
+			result.coordinates.push_back(stop.has_value()
+				? std::optional<geo::Coordinates>(stop.value()->coordinates)
+				: std::nullopt);
+			result.stops.push_back(stop.has_value() ? std::optional<domain::StopId>(stop.value()->id) : std::nullopt);
+		}
+
+		std::vector<std::string_view> bus_names;
+		bus_names.reserve(route_graph.buses.size());
+		for (auto & bus_name : route_graph.buses) {
+			bus_names.push_back(tc_.FindRoute(bus_name).value()->name);
+		}
+
+		result.dominated_edge_count = route_graph.dominated_edge_count;
+		result.edges.reserve(route_graph.edges.size());
+		result.edges_info.reserve(route_graph.edges.size());
+		for (auto & edge : route_graph.edges) {
+			result.edges.push_back({edge.from, edge.to, edge.time});
+			result.edges_info.push_back({bus_names.at(edge.bus), edge.span_count, edge.type, edge.distance});
+		}
+		return result;
+	}
+
+	bool RequestHandler::HasRoutingProfile(const Query & query) const {
+		return query.profile || query.bus_wait_time || query.bus_velocity;
+	}
+
+	// Без профиля и поправок - nullopt, как и для неизвестного профиля или недопустимых значений:
+	// при нулевой или отрицательной скорости время поездки не определено
+	std::optional<TransportRouter::RoutingProfile> RequestHandler::MakeRoutingProfile(const Query & query) const {
+		if (!HasRoutingProfile(query)) {
+			return std::nullopt;
+		}
+		std::optional<TransportRouter::RoutingProfile> result = query.profile.has_value()
+			? router_.FindProfile(*query.profile)
+			: router_.GetDefaultProfile();
+		if (!result.has_value()) {
+			return std::nullopt;
+		}
+		if (query.bus_wait_time.has_value()) {
+			result->bus_wait_time = *query.bus_wait_time;
+		}
+		if (query.bus_velocity.has_value()) {
+			result->bus_velocity = *query.bus_velocity;
 		}
+		if (result->bus_velocity <= 0 || result->bus_wait_time < 0) {
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	// Запросы маршрутов группируются по остановке отправления и профилю, на группу выполняется один поиск.
+	// Ключ - индекс запроса, у запросов других типов, с неизвестной остановкой или профилем ответ пустой
+	std::vector<std::optional<TransportRouter::Route>> RequestHandler::PlanRoutes(const OutputGroup & outputs) const {
+		// Остановка отправления, задан ли профиль, время ожидания и скорость профиля
+		using GroupKey = std::tuple<domain::StopId, bool, int, double>;
+		std::map<GroupKey, std::vector<std::pair<size_t, domain::StopId>>> groups; // индекс запроса, остановка прибытия
+		for (size_t i = 0; i < outputs.queries.size(); ++i) {
+			const Query & query = outputs.queries[i];
+			if (query.type != QueryType::ROUTE) {
+				continue;
+			}
+			const std::optional<TransportRouter::RoutingProfile> profile = MakeRoutingProfile(query);
+			if (HasRoutingProfile(query) && !profile.has_value()) {
+				continue;
+			}
+			const auto from = tc_.FindStop(query.from);
+			const auto to = tc_.FindStop(query.to);
+			if (!from.has_value() || !to.has_value()) {
+				continue;
+			}
+			groups[GroupKey{
+				(*from)->id,
+				profile.has_value(),
+				profile.has_value() ? profile->bus_wait_time : 0,
+				profile.has_value() ? profile->bus_velocity : 0
+			}].emplace_back(i, (*to)->id);
+		}
+
+		std::vector<std::optional<TransportRouter::Route>> result(outputs.queries.size());
+		for (const auto & [key, group] : groups) {
+			const auto & [from, has_profile, bus_wait_time, bus_velocity] = key;
+			std::vector<domain::StopId> targets;
+			targets.reserve(group.size());
+			for (const auto & [query_index, to] : group) {
+				targets.push_back(to);
+			}
+			std::vector<std::optional<TransportRouter::Route>> group_routes = router_.GetRoutes(from, targets,
+				has_profile
+					? std::optional<TransportRouter::RoutingProfile>({bus_wait_time, bus_velocity})
+					: std::nullopt);
+			for (size_t i = 0; i < group.size(); ++i) {
+				result[group[i].first] = std::move(group_routes[i]);
+			}
+		}
+		return result;
+	}
+
+	// nullopt, если хотя бы одна остановка не найдена
+	std::optional<std::vector<domain::StopId>> RequestHandler::FindStops(const std::vector<std::string> & names) const {
+		std::vector<domain::StopId> result;
+		result.reserve(names.size());
+		for (const std::string & name : names) {
+			const auto stop = tc_.FindStop(name);
+			if (!stop.has_value()) {
+				return std::nullopt;
+			}
+			result.push_back((*stop)->id);
+		}
+		return result;
+	}
+
+	// Участок от первого прохода маршрута через from до ближайшего следующего прохода через to.
+	// Расстояние - разность накопленных сумм маршрута
+	std::optional<SegmentInfo> RequestHandler::GetSegment(const Query & query) const {
+		const auto bus = tc_.FindRoute(query.name);
+		const auto from = tc_.FindStop(query.from);
+		const auto to = tc_.FindStop(query.to);
+		std::optional<TransportRouter::RoutingProfile> profile = MakeRoutingProfile(query);
+		if (!profile.has_value()) {
+			if (HasRoutingProfile(query)) {
+				return std::nullopt;
+			}
+			profile = router_.GetDefaultProfile();
+		}
+		if (!bus.has_value() || !from.has_value() || !to.has_value()) {
+			return std::nullopt;
+		}
+
+		const domain::RouteStops stops = (*bus)->GetRouteStops();
+		const auto from_it = std::find(stops.begin(), stops.end(), (*from)->id);
+		if (from_it == stops.end()) {
+			return std::nullopt;
+		}
+		const auto to_it = std::find(std::next(from_it), stops.end(), (*to)->id);
+		if (to_it == stops.end()) {
+			return std::nullopt;
+		}
+		const size_t from_index = from_it.GetIndex();
+		const size_t to_index = to_it.GetIndex();
+		const uint64_t distance = tc_.GetSegmentDistance(*bus, from_index, to_index).length;
+		// Скорость профиля в км/ч, время в минутах
+		return SegmentInfo{
+			distance,
+			distance / (profile->bus_velocity * 1000.0 / 60.0),
+			static_cast<int>(to_index - from_index) };
 	}
 
 	WritingResponces RequestHandler::GetTransportData(const OutputGroup & outputs){
 		WritingResponces result;
-		for (auto & entity : outputs.queries) {
+		result.reserve(outputs.queries.size());
+		const std::vector<std::optional<TransportRouter::Route>> routes = PlanRoutes(outputs);
+		for (size_t query_index = 0; query_index < outputs.queries.size(); ++query_index) {
+			const Query & entity = outputs.queries[query_index];
 			std::pair<int, Responce> responce;
 			responce.first = entity.id;
 
@@ -76,12 +308,46 @@ namespace transport::handler {
 			} else if (entity.type == QueryType::MAP) {
 				responce.second = GenerateMap();
 			} else if (entity.type == QueryType::ROUTE) {
-				auto route = router_.GetRoute(entity.from, entity.to);
-				if (route.has_value()) {
-					responce.second = route.value();
+				if (routes[query_index].has_value()) {
+					responce.second = routes[query_index].value();
 				}else {
 					responce.second = Errors::NOT_FOUND;
 				}
+			} else if (entity.type == QueryType::ROUTE_MATRIX) {
+				// Неизвестная остановка - ошибка запроса, а не пустая ячейка, как у недостижимой пары
+				const std::optional<std::vector<domain::StopId>> sources = FindStops(entity.sources);
+				const std::optional<std::vector<domain::StopId>> targets = FindStops(entity.targets);
+				if (sources.has_value() && targets.has_value()) {
+					responce.second = router_.GetRouteMatrix(*sources, *targets);
+				} else {
+					responce.second = Errors::NOT_FOUND;
+				}
+			} else if (entity.type == QueryType::SEGMENT) {
+				auto segment = GetSegment(entity);
+				if (segment.has_value()) {
+					responce.second = segment.value();
+				} else {
+					responce.second = Errors::NOT_FOUND;
+				}
+			} else if (entity.type == QueryType::GRAPH) {
+				auto graph_stats = router_.GetGraphStats();
+				if (graph_stats.has_value()) {
+					responce.second = graph_stats.value();
+				} else {
+					responce.second = Errors::NOT_FOUND;
+				}
+			} else if (entity.type == QueryType::ROUTE_CACHE) {
+				responce.second = router_.GetRouteCacheStats();
+			} else if (entity.type == QueryType::ISOCHRONE) {
+				const auto from = tc_.FindStop(entity.from);
+				auto isochrone = from.has_value()
+					? router_.GetIsochrone((*from)->id, entity.max_time)
+					: std::nullopt;
+				if (isochrone.has_value()) {
+					responce.second = std::move(isochrone.value());
+				} else {
+					responce.second = Errors::NOT_FOUND;
+				}
 			}
 			result.push_back(responce);
 		}
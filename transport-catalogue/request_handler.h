@@ -13,6 +13,7 @@ namespace transport::handler {
 	struct Route {
 		bool is_looped;
 		std::vector<std::string> stops;
+		std::optional<TransportCatalogue::RouteInfo> info = std::nullopt; // из базы
 	};
 	struct InputGroup {
 		std::unordered_map<std::string, Stop> stops;
@@ -23,7 +24,12 @@ namespace transport::handler {
 		BUS,
 		STOP,
 		MAP,
-		ROUTE
+		ROUTE,
+		ROUTE_MATRIX,
+		ISOCHRONE,
+		SEGMENT,
+		GRAPH,
+		ROUTE_CACHE
 	};
 	struct Query {
 		int id;
@@ -31,12 +37,40 @@ namespace transport::handler {
 		std::string name;
 		std::string from;
 		std::string to;
+		// Для ROUTE_MATRIX
+		std::vector<std::string> sources;
+		std::vector<std::string> targets;
+		// Для ROUTE: профиль из настроек и поправки к нему
+		std::optional<std::string> profile;
+		std::optional<int> bus_wait_time;
+		std::optional<double> bus_velocity;
+		// Для SEGMENT: маршрут - name, остановки - from и to, скорость - из профиля, как у ROUTE
+		// Для ISOCHRONE: остановка отправления - from, бюджет времени в минутах
+		double max_time = 0;
 	};
 	struct OutputGroup {
 		std::vector<Query> queries;
 	};
+	struct RouteEdge {
+		size_t from;
+		size_t to;
+		double time;
+		size_t bus; // индекс в RouteGraph::buses
+		int span_count;
+		TransportRouter::EdgeType type;
+		int distance;
+	};
+	// Граф маршрутизатора, сохраненный в базе
+	struct RouteGraph {
+		std::vector<std::string> vertices; // названия остановок
+		std::vector<std::string> buses;
+		std::vector<RouteEdge> edges;
+		size_t dominated_edge_count = 0;
+		TransportRouter::Precomputed precomputed;
+	};
 	struct RouteGroup {
 		TransportRouter::RouterSettings settings;
+		std::optional<RouteGraph> graph;
 	};
 
 	struct DateBase {
@@ -51,11 +85,19 @@ namespace transport::handler {
 		DateBase data_base;
 	};
 
+	// Участок маршрута между двумя его остановками
+	struct SegmentInfo {
+		uint64_t distance; // метры по дороге
+		double time; // минуты в пути без ожидания
+		int span_count;
+	};
+
 	enum class Errors {
 		NOT_FOUND
 	};
 	using Responce = std::variant<Errors, std::vector<std::string_view>,
-		TransportCatalogue::RouteInfo, std::string, TransportRouter::Route>;
+		TransportCatalogue::RouteInfo, std::string, TransportRouter::Route, TransportRouter::RouteMatrix,
+		TransportRouter::Isochrone, SegmentInfo, TransportRouter::GraphStats, cache::CacheStats>;
 	using WritingResponces = std::vector<std::pair<int, Responce>>; // id, data
 
 	// Интерфейс чтения/записи
@@ -78,6 +120,13 @@ namespace transport::handler {
 		TransportRouter router_;
 
 		void FillTransportCatalogue(const InputGroup & inputs);
+		void UpdateTransportCatalogue(const InputGroup & inputs);
+		TransportRouter::GraphData MakeRouterGraph(const RouteGraph & route_graph) const;
+		bool HasRoutingProfile(const Query & query) const;
+		std::optional<TransportRouter::RoutingProfile> MakeRoutingProfile(const Query & query) const;
+		std::vector<std::optional<TransportRouter::Route>> PlanRoutes(const OutputGroup & outputs) const;
+		std::optional<std::vector<domain::StopId>> FindStops(const std::vector<std::string> & names) const;
+		std::optional<SegmentInfo> GetSegment(const Query & query) const;
 		WritingResponces GetTransportData(const OutputGroup & outputs);
 		std::string GenerateMap();
 	};
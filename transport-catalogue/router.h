@@ -1,26 +1,109 @@
 #pragma once
 
+#include "a_star.h"
+#include "contraction_hierarchy.h"
 #include "graph.h"
+#include "min_plus.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <iterator>
+#include <limits>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+namespace detail {
+
+// Точка синхронизации: Wait возвращает управление, когда до нее дойдут все count потоков
+class Barrier {
+public:
+	explicit Barrier(size_t count)
+		: count_(count) {}
+
+	void Wait() {
+		std::unique_lock lock(mutex_);
+		const size_t generation = generation_;
+		if (++waiting_ == count_) {
+			waiting_ = 0;
+			++generation_;
+			condition_.notify_all();
+		} else {
+			condition_.wait(lock, [this, generation] { return generation != generation_; });
+		}
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	const size_t count_;
+	size_t waiting_ = 0;
+	size_t generation_ = 0;
+};
+
+}  // namespace detail
+
+// Способ поиска маршрутов:
+// ALL_PAIRS - при создании заранее вычисляются маршруты между всеми парами вершин (O(V^3) времени, O(V^2) памяти),
+// DIJKSTRA - маршрут ищется при каждом запросе алгоритмом Дейкстры (O(E log V) на запрос, O(V+E) памяти),
+// CONTRACTION_HIERARCHY - при создании граф сжимается в иерархию (см. contraction_hierarchy.h),
+// маршрут ищется двунаправленным поиском по иерархии (доли миллисекунды на запрос, память почти линейна),
+// A_STAR - целенаправленный поиск A* с внешней нижней оценкой и опорными вершинами (см. a_star.h)
+enum class RouterStrategy {
+	ALL_PAIRS,
+	DIJKSTRA,
+	CONTRACTION_HIERARCHY,
+	A_STAR
+};
+
+// Таблица маршрутов между всеми парами вершин в плоском виде: строки фиксированной длины vertex_count,
+// данные маршрута from -> to лежат в ячейке from * vertex_count + to. Веса и последние ребра маршрутов
+// хранятся в отдельных массивах, ячейка занимает sizeof(Weight) + 4 байта.
+// Если маршрута нет, вес равен бесконечности, а последнее ребро - NO_EDGE
+inline constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+template <typename Weight>
+struct RoutesTable {
+	size_t vertex_count = 0;
+	std::vector<Weight> weights;
+	std::vector<uint32_t> prev_edges;
+};
+
+// Таблица, память которой принадлежит кому-то другому (например, отображена из файла)
+template <typename Weight>
+struct RoutesTableView {
+	size_t vertex_count = 0;
+	const Weight* weights = nullptr;
+	const uint32_t* prev_edges = nullptr;
+};
+
 template <typename Weight>
 class Router {
 private:
 	using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-	explicit Router(const Graph& graph);
+	// thread_count - число потоков предподсчета для стратегии ALL_PAIRS, 0 - по числу ядер
+	explicit Router(const Graph& graph, RouterStrategy strategy = RouterStrategy::ALL_PAIRS,
+		size_t thread_count = 1);
+	// Использует готовую таблицу маршрутов, таблица должна пережить маршрутизатор.
+	// thread_count - число потоков обновления таблицы при изменении графа
+	Router(const Graph& graph, RoutesTableView<Weight> routes, size_t thread_count = 1);
+	// Использует готовую иерархию сжатия
+	Router(const Graph& graph, HierarchyData<Weight> hierarchy);
+	// Стратегия A_STAR: выбирает landmark_count опорных вершин, lower_bound может быть пустой
+	Router(const Graph& graph, LowerBound<Weight> lower_bound, size_t landmark_count);
+	// Стратегия A_STAR с сохраненными опорными вершинами
+	Router(const Graph& graph, LowerBound<Weight> lower_bound, LandmarksData<Weight> landmarks);
 
 	struct RouteInfo {
 		Weight weight;
@@ -28,90 +111,787 @@ public:
 	};
 
 	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	// Маршруты из from в каждую вершину targets, ключ - индекс в targets. Для DIJKSTRA и A_STAR
+	// выполняется один поиск Дейкстры, который останавливается на последней из целей;
+	// ALL_PAIRS и CONTRACTION_HIERARCHY ищут маршрут до каждой цели отдельно
+	std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const;
+	// Веса кратчайших маршрутов из каждой вершины sources в каждую вершину targets построчно:
+	// маршруту sources[i] -> targets[j] соответствует ячейка i * targets.size() + j.
+	// Работа поиска делится между всеми парами, а не повторяется для каждой
+	std::vector<std::optional<Weight>> BuildWeights(const std::vector<VertexId>& sources,
+		const std::vector<VertexId>& targets) const;
 
-private:
-	struct RouteInternalData {
-		Weight weight;
-		std::optional<EdgeId> prev_edge;
-	};
-	using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+	// Вершины, достижимые из from с весом не больше max_weight, с весами кратчайших маршрутов
+	// в порядке возрастания веса. Поиск не выходит за пределы бюджета: просматривается только
+	// достижимая область (у ALL_PAIRS - одна строка таблицы)
+	std::vector<std::pair<VertexId, Weight>> BuildReachable(VertexId from, Weight max_weight) const;
+
+	RouterStrategy GetStrategy() const;
+
+	// Обновление после изменения графа, только для стратегий ALL_PAIRS и DIJKSTRA:
+	// иерархию и опорные вершины дешевле построить заново, создав новый маршрутизатор.
+	// Не потокобезопасно с поиском маршрутов.
+	// В граф добавлены вершины и ребра начиная с first_edge. В таблице меняются только маршруты,
+	// которые стали короче через новые ребра: O(V^2) на ребро в худшем случае, обычно намного меньше
+	void AddEdges(EdgeId first_edge);
+	// Из графа удалены ребра, new_edge_ids - результат DirectedWeightedGraph::RemoveEdges.
+	// Заново вычисляются только строки таблицы, маршруты которых проходили через удаленные ребра
+	void RemoveEdges(const std::vector<std::optional<EdgeId>>& new_edge_ids);
 
-	void InitializeRoutesInternalData(const Graph& graph) {
+	// Только для стратегии ALL_PAIRS
+	RoutesTableView<Weight> GetRoutesTable() const;
+	// Только для стратегии CONTRACTION_HIERARCHY
+	const HierarchyData<Weight>& GetHierarchyData() const;
+	// Только для стратегии A_STAR
+	const LandmarksData<Weight>& GetLandmarksData() const;
+
+private:
+	void InitializeRoutesTable(const Graph& graph) {
 		const size_t vertex_count = graph.GetVertexCount();
+		routes_.vertex_count = vertex_count;
+		routes_.weights.assign(vertex_count * vertex_count, INFINITE_WEIGHT);
+		routes_.prev_edges.assign(vertex_count * vertex_count, NO_EDGE);
 		for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-			routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+			Weight* row_weights = routes_.weights.data() + vertex * vertex_count;
+			uint32_t* row_prev_edges = routes_.prev_edges.data() + vertex * vertex_count;
+			row_weights[vertex] = ZERO_WEIGHT;
 			for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
 				const auto& edge = graph.GetEdge(edge_id);
 				if (edge.weight < ZERO_WEIGHT) {
 					throw std::domain_error("Edges' weights should be non-negative");
 				}
-				auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-				if (!route_internal_data || route_internal_data->weight > edge.weight) {
-					route_internal_data = RouteInternalData{edge.weight, edge_id};
+				if (edge.weight < row_weights[edge.to]) {
+					row_weights[edge.to] = edge.weight;
+					row_prev_edges[edge.to] = static_cast<uint32_t>(edge_id);
 				}
 			}
 		}
 	}
 
-	void RelaxRoute(VertexId vertex_from, VertexId vertex_to,
-		const RouteInternalData& route_from, const RouteInternalData& route_to)
-	{
-		auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-		const Weight candidate_weight = route_from.weight + route_to.weight;
-		if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-			route_relaxing = {candidate_weight,
-				route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+	// Отсутствующий маршрут имеет бесконечный вес, поэтому и путь через него бесконечен
+	// и никогда не оказывается лучше: проверки наличия маршрута во внутреннем цикле не нужны.
+	// Внутренний цикл векторизован для double (см. min_plus.h)
+	void RelaxRouteRowThroughVertex(size_t vertex_count, VertexId vertex_from, VertexId vertex_through) {
+		Weight* row_weights = routes_.weights.data() + vertex_from * vertex_count;
+		uint32_t* row_prev_edges = routes_.prev_edges.data() + vertex_from * vertex_count;
+		const Weight weight_from = row_weights[vertex_through];
+		if (weight_from == INFINITE_WEIGHT) {
+			return;
 		}
+		const uint32_t prev_edge_from = row_prev_edges[vertex_through];
+		const Weight* through_weights = routes_.weights.data() + vertex_through * vertex_count;
+		const uint32_t* through_prev_edges = routes_.prev_edges.data() + vertex_through * vertex_count;
+		detail::RelaxRouteRow(row_weights, row_prev_edges, weight_from, prev_edge_from,
+			through_weights, through_prev_edges, vertex_count, NO_EDGE);
 	}
 
-	void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
+	void RelaxRoutesTableThroughVertex(size_t vertex_count, VertexId vertex_through) {
 		for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-			if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-				for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-					if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-						RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+			RelaxRouteRowThroughVertex(vertex_count, vertex_from, vertex_through);
+		}
+	}
+
+	// Строки таблицы на шаге vertex_through не зависят друг от друга: строка vertex_through
+	// и столбец vertex_through на этом шаге не меняются (вес пути из вершины в себя нулевой).
+	// Поэтому строки делятся на блоки между потоками, а после каждого шага потоки ждут друг друга.
+	// Порядок сравнений внутри строки тот же, что и в однопоточном варианте, результат совпадает побитово
+	void RelaxRoutesTable(size_t vertex_count, size_t thread_count) {
+		thread_count = std::min(thread_count, (vertex_count + ROWS_BLOCK_SIZE - 1) / ROWS_BLOCK_SIZE);
+		if (thread_count <= 1) {
+			for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+				RelaxRoutesTableThroughVertex(vertex_count, vertex_through);
+			}
+			return;
+		}
+
+		detail::Barrier barrier(thread_count);
+		const auto relax_blocks = [this, vertex_count, thread_count, &barrier](size_t thread_index) {
+			for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+				// Блоки раздаются потокам по кругу, чтобы пустые строки не достались одному потоку
+				for (size_t block_begin = thread_index * ROWS_BLOCK_SIZE; block_begin < vertex_count;
+					block_begin += thread_count * ROWS_BLOCK_SIZE)
+				{
+					const size_t block_end = std::min(block_begin + ROWS_BLOCK_SIZE, vertex_count);
+					for (VertexId vertex_from = block_begin; vertex_from < block_end; ++vertex_from) {
+						RelaxRouteRowThroughVertex(vertex_count, vertex_from, vertex_through);
 					}
 				}
+				barrier.Wait();
 			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(thread_count - 1);
+		for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+			threads.emplace_back(relax_blocks, thread_index);
+		}
+		relax_blocks(0);
+		for (auto& thread : threads) {
+			thread.join();
 		}
 	}
 
+	// Буферы поиска переиспользуются между запросами одного потока.
+	// Вершина считается посещенной текущим поиском, если ее метка совпадает с search_id
+	struct SearchData {
+		std::vector<Weight> weights;
+		std::vector<std::optional<EdgeId>> prev_edges;
+		std::vector<uint32_t> search_ids;
+		uint32_t search_id = 0;
+		std::vector<std::pair<Weight, VertexId>> queue;
+	};
+
+	static SearchData& GetSearchData(size_t vertex_count) {
+		thread_local SearchData data;
+		if (data.search_ids.size() < vertex_count) {
+			data.weights.resize(vertex_count);
+			data.prev_edges.resize(vertex_count);
+			data.search_ids.resize(vertex_count, 0);
+		}
+		if (++data.search_id == 0) {
+			// Счетчик переполнился - старые метки могут совпасть с новыми
+			std::fill(data.search_ids.begin(), data.search_ids.end(), 0);
+			data.search_id = 1;
+		}
+		data.queue.clear();
+		return data;
+	}
+
+	void CheckEdgesWeights(const Graph& graph, EdgeId first_edge = 0) const {
+		for (EdgeId edge_id = first_edge; edge_id < graph.GetEdgeCount(); ++edge_id) {
+			if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+				throw std::domain_error("Edges' weights should be non-negative");
+			}
+		}
+	}
+
+	void CheckUpdatable() const;
+	void PrepareOwnRoutesTable();
+	void RelaxRoutesTableThroughEdge(EdgeId edge_id);
+	void RebuildRouteRow(VertexId from);
+
+	std::optional<RouteInfo> BuildRouteWithTable(VertexId from, VertexId to) const;
+	std::optional<RouteInfo> BuildRouteWithDijkstra(VertexId from, VertexId to) const;
+	std::optional<RouteInfo> ExtractRoute(const SearchData& data, VertexId to) const;
+	void BuildWeightsWithDijkstra(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets,
+		std::vector<std::optional<Weight>>& result) const;
+
 	static constexpr Weight ZERO_WEIGHT{};
+	static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+	static constexpr size_t ROWS_BLOCK_SIZE = 16;
+	static constexpr size_t DEFAULT_LANDMARK_COUNT = 8;
 	const Graph& graph_;
-	RoutesInternalData routes_internal_data_;
+	RouterStrategy strategy_;
+	size_t thread_count_ = 1;
+	RoutesTable<Weight> routes_; // собственная таблица, пуста, если используется внешняя
+	RoutesTableView<Weight> external_routes_;
+	std::optional<ContractionHierarchy<Weight>> hierarchy_;
+	std::optional<AStarSearch<Weight>> a_star_;
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+Router<Weight>::Router(const Graph& graph, RouterStrategy strategy, size_t thread_count)
+	: graph_(graph)
+	, strategy_(strategy)
+{
+	if (strategy_ == RouterStrategy::DIJKSTRA) {
+		CheckEdgesWeights(graph);
+		return;
+	}
+	if (strategy_ == RouterStrategy::CONTRACTION_HIERARCHY) {
+		hierarchy_.emplace(graph);
+		return;
+	}
+	if (strategy_ == RouterStrategy::A_STAR) {
+		a_star_.emplace(graph, LowerBound<Weight>{}, DEFAULT_LANDMARK_COUNT);
+		return;
+	}
+
+	static_assert(std::numeric_limits<Weight>::has_infinity, "Weight should have infinity value");
+	if (graph.GetEdgeCount() >= NO_EDGE) {
+		throw std::length_error("Too many edges for routes table");
+	}
+	InitializeRoutesTable(graph);
+
+	if (thread_count == 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+	thread_count_ = thread_count;
+	RelaxRoutesTable(graph.GetVertexCount(), thread_count);
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, RoutesTableView<Weight> routes, size_t thread_count)
+	: graph_(graph)
+	, strategy_(RouterStrategy::ALL_PAIRS)
+	, thread_count_(thread_count == 0 ? std::max(1u, std::thread::hardware_concurrency()) : thread_count)
+	, external_routes_(routes)
+{
+	static_assert(std::numeric_limits<Weight>::has_infinity, "Weight should have infinity value");
+	if (routes.vertex_count != graph.GetVertexCount() || !routes.weights || !routes.prev_edges) {
+		throw std::invalid_argument("Routes table doesn't match the graph");
+	}
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, HierarchyData<Weight> hierarchy)
+	: graph_(graph)
+	, strategy_(RouterStrategy::CONTRACTION_HIERARCHY)
+{
+	hierarchy_.emplace(graph, std::move(hierarchy));
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, LowerBound<Weight> lower_bound, size_t landmark_count)
+	: graph_(graph)
+	, strategy_(RouterStrategy::A_STAR)
+{
+	a_star_.emplace(graph, std::move(lower_bound), landmark_count);
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, LowerBound<Weight> lower_bound, LandmarksData<Weight> landmarks)
 	: graph_(graph)
-	, routes_internal_data_(graph.GetVertexCount(),
-		std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+	, strategy_(RouterStrategy::A_STAR)
 {
-	InitializeRoutesInternalData(graph);
+	a_star_.emplace(graph, std::move(lower_bound), std::move(landmarks));
+}
+
+template <typename Weight>
+RouterStrategy Router<Weight>::GetStrategy() const {
+	return strategy_;
+}
+
+template <typename Weight>
+RoutesTableView<Weight> Router<Weight>::GetRoutesTable() const {
+	if (strategy_ != RouterStrategy::ALL_PAIRS) {
+		throw std::logic_error("Routes table is built only by ALL_PAIRS strategy");
+	}
+	if (external_routes_.weights) {
+		return external_routes_;
+	}
+	return {routes_.vertex_count, routes_.weights.data(), routes_.prev_edges.data()};
+}
+
+template <typename Weight>
+const HierarchyData<Weight>& Router<Weight>::GetHierarchyData() const {
+	if (!hierarchy_) {
+		throw std::logic_error("Hierarchy is built only by CONTRACTION_HIERARCHY strategy");
+	}
+	return hierarchy_->GetData();
+}
+
+template <typename Weight>
+const LandmarksData<Weight>& Router<Weight>::GetLandmarksData() const {
+	if (!a_star_) {
+		throw std::logic_error("Landmarks are built only by A_STAR strategy");
+	}
+	return a_star_->GetLandmarksData();
+}
+
+template <typename Weight>
+void Router<Weight>::CheckUpdatable() const {
+	if (strategy_ != RouterStrategy::ALL_PAIRS && strategy_ != RouterStrategy::DIJKSTRA) {
+		throw std::logic_error("Only ALL_PAIRS and DIJKSTRA routers can be updated");
+	}
+}
+
+template <typename Weight>
+void Router<Weight>::AddEdges(EdgeId first_edge) {
+	CheckUpdatable();
+	CheckEdgesWeights(graph_, first_edge);
+	if (strategy_ == RouterStrategy::DIJKSTRA) {
+		return;
+	}
+	if (graph_.GetEdgeCount() >= NO_EDGE) {
+		throw std::length_error("Too many edges for routes table");
+	}
+	PrepareOwnRoutesTable();
+	for (EdgeId edge_id = first_edge; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+		RelaxRoutesTableThroughEdge(edge_id);
+	}
+}
+
+template <typename Weight>
+void Router<Weight>::RemoveEdges(const std::vector<std::optional<EdgeId>>& new_edge_ids) {
+	CheckUpdatable();
+	if (strategy_ == RouterStrategy::DIJKSTRA) {
+		return;
+	}
+	PrepareOwnRoutesTable();
+	const size_t vertex_count = routes_.vertex_count;
+	std::vector<VertexId> broken_rows;
+	for (VertexId from = 0; from < vertex_count; ++from) {
+		uint32_t* row_prev_edges = routes_.prev_edges.data() + from * vertex_count;
+		bool is_broken = false;
+		for (VertexId to = 0; to < vertex_count; ++to) {
+			if (row_prev_edges[to] == NO_EDGE) {
+				continue;
+			}
+			if (const std::optional<EdgeId> new_id = new_edge_ids.at(row_prev_edges[to])) {
+				row_prev_edges[to] = static_cast<uint32_t>(*new_id);
+			} else {
+				is_broken = true;
+			}
+		}
+		if (is_broken) {
+			broken_rows.push_back(from);
+		}
+	}
+	// Удаление ребер не делает маршруты короче, поэтому строки без удаленных ребер остаются верными.
+	// Строки пересчитываются независимо друг от друга и раздаются потокам по одной
+	std::atomic<size_t> next_row = 0;
+	const auto rebuild_rows = [this, &broken_rows, &next_row]() {
+		for (size_t i = next_row++; i < broken_rows.size(); i = next_row++) {
+			RebuildRouteRow(broken_rows[i]);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t thread_index = 1; thread_index < std::min(thread_count_, broken_rows.size()); ++thread_index) {
+		threads.emplace_back(rebuild_rows);
+	}
+	rebuild_rows();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+// Переносит внешнюю таблицу в собственную память и расширяет таблицу до числа вершин графа
+template <typename Weight>
+void Router<Weight>::PrepareOwnRoutesTable() {
+	const RoutesTableView<Weight> old_routes = GetRoutesTable();
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (!external_routes_.weights && old_routes.vertex_count == vertex_count) {
+		return;
+	}
+	RoutesTable<Weight> routes;
+	routes.vertex_count = vertex_count;
+	routes.weights.assign(vertex_count * vertex_count, INFINITE_WEIGHT);
+	routes.prev_edges.assign(vertex_count * vertex_count, NO_EDGE);
+	for (VertexId from = 0; from < old_routes.vertex_count; ++from) {
+		std::copy_n(old_routes.weights + from * old_routes.vertex_count, old_routes.vertex_count,
+			routes.weights.begin() + from * vertex_count);
+		std::copy_n(old_routes.prev_edges + from * old_routes.vertex_count, old_routes.vertex_count,
+			routes.prev_edges.begin() + from * vertex_count);
+	}
+	for (VertexId vertex = old_routes.vertex_count; vertex < vertex_count; ++vertex) {
+		routes.weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
+	}
+	routes_ = std::move(routes);
+	external_routes_ = {};
+}
+
+// Новый кратчайший путь from -> to может пройти через ребро u -> v только как from -> u -> v -> to.
+// Столбцы to, которым ребро не помогает даже из u, и строки from, которым оно не помогает дойти до v,
+// пропускаются. Строка v и столбец u при этом не меняются, поэтому обновление идет на месте
+template <typename Weight>
+void Router<Weight>::RelaxRoutesTableThroughEdge(EdgeId edge_id) {
+	const auto& edge = graph_.GetEdge(edge_id);
+	const size_t vertex_count = routes_.vertex_count;
+	const Weight* from_u_weights = routes_.weights.data() + edge.from * vertex_count;
+	const Weight* from_v_weights = routes_.weights.data() + edge.to * vertex_count;
+	const uint32_t* from_v_prev_edges = routes_.prev_edges.data() + edge.to * vertex_count;
+
+	std::vector<VertexId> columns;
+	for (VertexId to = 0; to < vertex_count; ++to) {
+		if (edge.weight + from_v_weights[to] < from_u_weights[to]) {
+			columns.push_back(to);
+		}
+	}
+	if (columns.empty()) {
+		return;
+	}
 
-	const size_t vertex_count = graph.GetVertexCount();
-	for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-		RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+	for (VertexId from = 0; from < vertex_count; ++from) {
+		Weight* row_weights = routes_.weights.data() + from * vertex_count;
+		uint32_t* row_prev_edges = routes_.prev_edges.data() + from * vertex_count;
+		const Weight weight_to_v = row_weights[edge.from] + edge.weight;
+		if (!(weight_to_v < row_weights[edge.to])) {
+			continue;
+		}
+		for (const VertexId to : columns) {
+			const Weight candidate_weight = weight_to_v + from_v_weights[to];
+			if (candidate_weight < row_weights[to]) {
+				row_weights[to] = candidate_weight;
+				row_prev_edges[to] = from_v_prev_edges[to] != NO_EDGE
+					? from_v_prev_edges[to]
+					: static_cast<uint32_t>(edge_id);
+			}
+		}
+	}
+}
+
+template <typename Weight>
+void Router<Weight>::RebuildRouteRow(VertexId from) {
+	const size_t vertex_count = routes_.vertex_count;
+	Weight* row_weights = routes_.weights.data() + from * vertex_count;
+	uint32_t* row_prev_edges = routes_.prev_edges.data() + from * vertex_count;
+	std::fill_n(row_weights, vertex_count, INFINITE_WEIGHT);
+	std::fill_n(row_prev_edges, vertex_count, NO_EDGE);
+	row_weights[from] = ZERO_WEIGHT;
+
+	std::vector<std::pair<Weight, VertexId>> queue{{ZERO_WEIGHT, from}};
+	const auto queue_compare = [](const auto& lhs, const auto& rhs) {
+		return lhs.first > rhs.first;
+	};
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), queue_compare);
+		const auto [weight, vertex] = queue.back();
+		queue.pop_back();
+		if (row_weights[vertex] < weight) {
+			continue;
+		}
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+			const auto& edge = graph_.GetEdge(edge_id);
+			const Weight candidate_weight = weight + edge.weight;
+			if (candidate_weight < row_weights[edge.to]) {
+				row_weights[edge.to] = candidate_weight;
+				row_prev_edges[edge.to] = static_cast<uint32_t>(edge_id);
+				queue.emplace_back(candidate_weight, edge.to);
+				std::push_heap(queue.begin(), queue.end(), queue_compare);
+			}
+		}
 	}
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from, VertexId to) const {
-	const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-	if (!route_internal_data) {
+	if (strategy_ == RouterStrategy::DIJKSTRA) {
+		return BuildRouteWithDijkstra(from, to);
+	}
+	if (strategy_ == RouterStrategy::CONTRACTION_HIERARCHY) {
+		auto route = hierarchy_->BuildRoute(from, to);
+		if (!route) {
+			return std::nullopt;
+		}
+		return RouteInfo{route->weight, std::move(route->edges)};
+	}
+	if (strategy_ == RouterStrategy::A_STAR) {
+		auto route = a_star_->BuildRoute(from, to);
+		if (!route) {
+			return std::nullopt;
+		}
+		return RouteInfo{route->weight, std::move(route->edges)};
+	}
+	return BuildRouteWithTable(from, to);
+}
+
+template <typename Weight>
+std::vector<std::optional<typename Router<Weight>::RouteInfo>> Router<Weight>::BuildRoutes(VertexId from,
+	const std::vector<VertexId>& targets) const
+{
+	std::vector<std::optional<RouteInfo>> result(targets.size());
+	// Таблице и иерархии общий поиск не нужен, а для одной цели поиск A* быстрее поиска Дейкстры
+	if (strategy_ == RouterStrategy::ALL_PAIRS || strategy_ == RouterStrategy::CONTRACTION_HIERARCHY
+		|| targets.size() < 2)
+	{
+		for (size_t i = 0; i < targets.size(); ++i) {
+			result[i] = BuildRoute(from, targets[i]);
+		}
+		return result;
+	}
+
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count || std::any_of(targets.begin(), targets.end(), [vertex_count](VertexId vertex) {
+		return vertex >= vertex_count;
+	})) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+	std::vector<bool> is_pending(vertex_count, false);
+	size_t pending_count = 0;
+	for (const VertexId target : targets) {
+		if (!is_pending[target]) {
+			is_pending[target] = true;
+			++pending_count;
+		}
+	}
+
+	SearchData& data = GetSearchData(vertex_count);
+	auto& queue = data.queue;
+	const auto queue_compare = [](const auto& lhs, const auto& rhs) {
+		return lhs.first > rhs.first;
+	};
+	data.search_ids[from] = data.search_id;
+	data.weights[from] = ZERO_WEIGHT;
+	data.prev_edges[from] = std::nullopt;
+	queue.emplace_back(ZERO_WEIGHT, from);
+
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), queue_compare);
+		const auto [weight, vertex] = queue.back();
+		queue.pop_back();
+		if (data.weights[vertex] < weight) {
+			continue;
+		}
+		// Последнее ребро достигнутой цели больше не меняется
+		if (is_pending[vertex]) {
+			is_pending[vertex] = false;
+			if (--pending_count == 0) {
+				break;
+			}
+		}
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+			const auto& edge = graph_.GetEdge(edge_id);
+			const Weight candidate_weight = weight + edge.weight;
+			if (data.search_ids[edge.to] != data.search_id || candidate_weight < data.weights[edge.to]) {
+				data.search_ids[edge.to] = data.search_id;
+				data.weights[edge.to] = candidate_weight;
+				data.prev_edges[edge.to] = edge_id;
+				queue.emplace_back(candidate_weight, edge.to);
+				std::push_heap(queue.begin(), queue.end(), queue_compare);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < targets.size(); ++i) {
+		result[i] = ExtractRoute(data, targets[i]);
+	}
+	return result;
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> Router<Weight>::BuildWeights(const std::vector<VertexId>& sources,
+	const std::vector<VertexId>& targets) const
+{
+	const size_t vertex_count = graph_.GetVertexCount();
+	const auto is_out_of_range = [vertex_count](VertexId vertex) {
+		return vertex >= vertex_count;
+	};
+	if (std::any_of(sources.begin(), sources.end(), is_out_of_range)
+		|| std::any_of(targets.begin(), targets.end(), is_out_of_range))
+	{
+		throw std::out_of_range("Vertex id is out of range");
+	}
+
+	if (strategy_ == RouterStrategy::CONTRACTION_HIERARCHY) {
+		return hierarchy_->BuildWeights(sources, targets);
+	}
+	std::vector<std::optional<Weight>> result(sources.size() * targets.size());
+	// Оценка A* направлена на одну цель, поэтому для многих целей выгоднее обычный поиск
+	if (strategy_ == RouterStrategy::DIJKSTRA || strategy_ == RouterStrategy::A_STAR) {
+		BuildWeightsWithDijkstra(sources, targets, result);
+		return result;
+	}
+
+	const RoutesTableView<Weight> routes = GetRoutesTable();
+	for (size_t i = 0; i < sources.size(); ++i) {
+		const Weight* row_weights = routes.weights + sources[i] * routes.vertex_count;
+		for (size_t j = 0; j < targets.size(); ++j) {
+			if (row_weights[targets[j]] != INFINITE_WEIGHT) {
+				result[i * targets.size() + j] = row_weights[targets[j]];
+			}
+		}
+	}
+	return result;
+}
+
+// Иерархия и опорные вершины полезны только для поиска до одной цели, поэтому для всех стратегий,
+// кроме ALL_PAIRS, выполняется поиск Дейкстры по исходному графу, ограниченный бюджетом
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> Router<Weight>::BuildReachable(VertexId from, Weight max_weight) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+	std::vector<std::pair<VertexId, Weight>> result;
+
+	if (strategy_ == RouterStrategy::ALL_PAIRS) {
+		const RoutesTableView<Weight> routes = GetRoutesTable();
+		const Weight* row_weights = routes.weights + from * routes.vertex_count;
+		for (VertexId to = 0; to < routes.vertex_count; ++to) {
+			if (row_weights[to] <= max_weight) {
+				result.emplace_back(to, row_weights[to]);
+			}
+		}
+		std::stable_sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.second < rhs.second;
+		});
+		return result;
+	}
+
+	SearchData& data = GetSearchData(vertex_count);
+	auto& queue = data.queue;
+	const auto queue_compare = [](const auto& lhs, const auto& rhs) {
+		return lhs.first > rhs.first;
+	};
+	data.search_ids[from] = data.search_id;
+	data.weights[from] = ZERO_WEIGHT;
+	queue.emplace_back(ZERO_WEIGHT, from);
+
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), queue_compare);
+		const auto [weight, vertex] = queue.back();
+		queue.pop_back();
+		if (data.weights[vertex] < weight) {
+			continue;
+		}
+		result.emplace_back(vertex, weight);
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+			const auto& edge = graph_.GetEdge(edge_id);
+			const Weight candidate_weight = weight + edge.weight;
+			// Вершины за пределами бюджета не попадают в очередь, поэтому и не раскрываются
+			if (candidate_weight > max_weight) {
+				continue;
+			}
+			if (data.search_ids[edge.to] != data.search_id || candidate_weight < data.weights[edge.to]) {
+				data.search_ids[edge.to] = data.search_id;
+				data.weights[edge.to] = candidate_weight;
+				queue.emplace_back(candidate_weight, edge.to);
+				std::push_heap(queue.begin(), queue.end(), queue_compare);
+			}
+		}
+	}
+	return result;
+}
+
+// Из каждого источника выполняется один поиск, он останавливается, как только достигнуты все цели
+template <typename Weight>
+void Router<Weight>::BuildWeightsWithDijkstra(const std::vector<VertexId>& sources,
+	const std::vector<VertexId>& targets, std::vector<std::optional<Weight>>& result) const
+{
+	const size_t vertex_count = graph_.GetVertexCount();
+	std::vector<bool> is_target(vertex_count, false);
+	for (const VertexId target : targets) {
+		is_target[target] = true;
+	}
+	const size_t target_count = std::count(is_target.begin(), is_target.end(), true);
+	std::vector<bool> reached(vertex_count, false);
+	std::vector<VertexId> reached_targets;
+	const auto queue_compare = [](const auto& lhs, const auto& rhs) {
+		return lhs.first > rhs.first;
+	};
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		SearchData& data = GetSearchData(vertex_count);
+		auto& queue = data.queue;
+		data.search_ids[sources[i]] = data.search_id;
+		data.weights[sources[i]] = ZERO_WEIGHT;
+		queue.emplace_back(ZERO_WEIGHT, sources[i]);
+
+		reached_targets.clear();
+		while (!queue.empty() && reached_targets.size() < target_count) {
+			std::pop_heap(queue.begin(), queue.end(), queue_compare);
+			const auto [weight, vertex] = queue.back();
+			queue.pop_back();
+			if (data.weights[vertex] < weight) {
+				continue;
+			}
+			if (is_target[vertex] && !reached[vertex]) {
+				reached[vertex] = true;
+				reached_targets.push_back(vertex);
+			}
+			for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+				const auto& edge = graph_.GetEdge(edge_id);
+				const Weight candidate_weight = weight + edge.weight;
+				if (data.search_ids[edge.to] != data.search_id || candidate_weight < data.weights[edge.to]) {
+					data.search_ids[edge.to] = data.search_id;
+					data.weights[edge.to] = candidate_weight;
+					queue.emplace_back(candidate_weight, edge.to);
+					std::push_heap(queue.begin(), queue.end(), queue_compare);
+				}
+			}
+		}
+
+		for (size_t j = 0; j < targets.size(); ++j) {
+			if (reached[targets[j]]) {
+				result[i * targets.size() + j] = data.weights[targets[j]];
+			}
+		}
+		for (const VertexId vertex : reached_targets) {
+			reached[vertex] = false;
+		}
+	}
+}
+
+template <typename Weight>
+std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRouteWithTable(VertexId from, VertexId to) const {
+	const RoutesTableView<Weight> routes = GetRoutesTable();
+	const size_t vertex_count = routes.vertex_count;
+	if (from >= vertex_count || to >= vertex_count) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+	// Весь путь восстанавливается по одной строке таблицы
+	const Weight* row_weights = routes.weights + from * vertex_count;
+	const uint32_t* row_prev_edges = routes.prev_edges + from * vertex_count;
+	if (row_weights[to] == INFINITE_WEIGHT) {
+		return std::nullopt;
+	}
+
+	std::vector<EdgeId> edges;
+	for (uint32_t edge_id = row_prev_edges[to];
+		edge_id != NO_EDGE;
+		edge_id = row_prev_edges[graph_.GetEdge(edge_id).from])
+	{
+		edges.push_back(edge_id);
+	}
+	std::reverse(edges.begin(), edges.end());
+
+	return RouteInfo{row_weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRouteWithDijkstra(VertexId from, VertexId to) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	if (from >= vertex_count || to >= vertex_count) {
+		throw std::out_of_range("Vertex id is out of range");
+	}
+
+	SearchData& data = GetSearchData(vertex_count);
+	auto& queue = data.queue;
+	// Куча с минимальным весом на вершине
+	const auto queue_compare = [](const auto& lhs, const auto& rhs) {
+		return lhs.first > rhs.first;
+	};
+
+	data.search_ids[from] = data.search_id;
+	data.weights[from] = ZERO_WEIGHT;
+	data.prev_edges[from] = std::nullopt;
+	queue.emplace_back(ZERO_WEIGHT, from);
+
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), queue_compare);
+		const auto [weight, vertex] = queue.back();
+		queue.pop_back();
+		if (data.weights[vertex] < weight) {
+			// Устаревшая запись: вершина уже достигнута более коротким путем
+			continue;
+		}
+		if (vertex == to) {
+			break;
+		}
+		for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+			const auto& edge = graph_.GetEdge(edge_id);
+			const Weight candidate_weight = weight + edge.weight;
+			if (data.search_ids[edge.to] != data.search_id || candidate_weight < data.weights[edge.to]) {
+				data.search_ids[edge.to] = data.search_id;
+				data.weights[edge.to] = candidate_weight;
+				data.prev_edges[edge.to] = edge_id;
+				queue.emplace_back(candidate_weight, edge.to);
+				std::push_heap(queue.begin(), queue.end(), queue_compare);
+			}
+		}
+	}
+
+	return ExtractRoute(data, to);
+}
+
+// Путь восстанавливается по последним ребрам, найденным поиском Дейкстры
+template <typename Weight>
+std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::ExtractRoute(const SearchData& data, VertexId to) const {
+	if (data.search_ids[to] != data.search_id) {
 		return std::nullopt;
 	}
-	const Weight weight = route_internal_data->weight;
+
 	std::vector<EdgeId> edges;
-	for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+	for (std::optional<EdgeId> edge_id = data.prev_edges[to];
 		edge_id;
-		edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+		edge_id = data.prev_edges[graph_.GetEdge(*edge_id).from])
 	{
 		edges.push_back(*edge_id);
 	}
 	std::reverse(edges.begin(), edges.end());
 
-	return RouteInfo{weight, std::move(edges)};
+	return RouteInfo{data.weights[to], std::move(edges)};
 }
 
 }  // namespace graph
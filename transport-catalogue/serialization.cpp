@@ -3,49 +3,110 @@
 #include <transport_catalogue.pb.h>
 #include <map_renderer.pb.h>
 #include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace transport::serialization {
 	using Path = std::filesystem::path;
 
 	namespace detail {
+		// Формат файла базы: [FileHeader][GeneralMessage][выравнивание][таблица маршрутов].
+		// Таблица маршрутов записывается как есть (V*V весов double, затем V*V номеров ребер uint32,
+		// в порядке байт текущей машины), чтобы ее можно было отобразить в память без разбора.
+		// Файлы без заголовка целиком содержат GeneralMessage (старый формат)
+		struct FileHeader {
+			char magic[8];
+			uint64_t message_size;
+		};
+		constexpr char FILE_MAGIC[8] = {'T', 'C', 'B', 'A', 'S', 'E', '0', '1'};
+		constexpr uint64_t ROUTES_TABLE_ALIGNMENT = 4096;
+
+		uint64_t GetRoutesTableOffset(uint64_t message_size) {
+			const uint64_t end = sizeof(FileHeader) + message_size;
+			return (end + ROUTES_TABLE_ALIGNMENT - 1) / ROUTES_TABLE_ALIGNMENT * ROUTES_TABLE_ALIGNMENT;
+		}
+
+		uint64_t GetRoutesTableSize(uint64_t vertex_count) {
+			return vertex_count * vertex_count * (sizeof(double) + sizeof(uint32_t));
+		}
+
+		struct MappedFile {
+			std::shared_ptr<const void> data;
+			size_t size;
+		};
+
+		std::optional<MappedFile> MapFile(const Path & file_name) {
+			int fd = open(file_name.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return std::nullopt;
+			}
+			struct stat file_stat;
+			if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+				close(fd);
+				return std::nullopt;
+			}
+			const size_t size = static_cast<size_t>(file_stat.st_size);
+			void * data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			// Отображение остается действительным и после закрытия файла
+			close(fd);
+			if (data == MAP_FAILED) {
+				return std::nullopt;
+			}
+			return MappedFile{
+				std::shared_ptr<const void>(data, [size](const void * ptr){
+					munmap(const_cast<void *>(ptr), size);
+				}),
+				size
+			};
+		}
+
 		void SerializeStops(const std::vector<domain::StopPtr> & stops,
 			data_base::TransportCatalogue & result_catalogue)
 		{
 			for (auto stop : stops) {
 				data_base::Stop result_stop;
-				result_stop.set_name(stop->name);
+				result_stop.set_name(std::string(stop->name));
 				result_stop.set_lat(stop->coordinates.lat);
 				result_stop.set_lng(stop->coordinates.lng);
 				*result_catalogue.add_stops() = result_stop;
 			}
 		}
 
-		void SerializeBuses(const std::vector<domain::BusPtr> & buses,
-			const std::unordered_map<domain::StopPtr, size_t> & stops_indexes,
+		// Индекс остановки в базе совпадает с ее индексом в справочнике
+		void SerializeBuses(const std::vector<domain::BusPtr> & buses, const TransportCatalogue & transport_catalogue,
 			data_base::TransportCatalogue & result_catalogue )
 		{
 			for (auto bus : buses) {
 				data_base::Bus result_bus;
-				result_bus.set_name(bus->name);
+				result_bus.set_name(std::string(bus->name));
 				result_bus.set_is_looped(bus->is_looped);
 
-				size_t route_size = bus->is_looped ? bus->stops.size() : bus->stops.size() / 2 + 1;
-				for (size_t i = 0; i < route_size; ++i) {
-					result_bus.add_stops_id(stops_indexes.at(bus->stops.at(i)));
+				for (domain::StopId stop : bus->stops) {
+					result_bus.add_stops_id(stop);
 				}
 
+				const TransportCatalogue::RouteInfo info = transport_catalogue.GetRouteInfo(bus);
+				data_base::RouteInfo & result_info = *result_bus.mutable_route_info();
+				result_info.set_stops_count(info.stops_count);
+				result_info.set_unique_stops_count(info.unique_stops_count);
+				result_info.set_length(info.length);
+				result_info.set_curvature(info.curvature);
+
 				*result_catalogue.add_buses() = result_bus;
 			}
 		}
 
 		void SerializeDistances (const std::vector<TransportCatalogue::Distance> & distances,
-			const std::unordered_map<domain::StopPtr, size_t> & stops_indexes,
 			data_base::TransportCatalogue & result_catalogue)
 		{
 			for (auto distance : distances) {
 				data_base::Distance result_distance;
-				result_distance.set_stop_id_from(stops_indexes.at(distance.from_stop));
-				result_distance.set_stop_id_to(stops_indexes.at(distance.to_stop));
+				result_distance.set_stop_id_from(distance.from_stop);
+				result_distance.set_stop_id_to(distance.to_stop);
 				result_distance.set_distance(distance.distance);
 				*result_catalogue.add_distances() = result_distance;
 			}
@@ -55,22 +116,17 @@ namespace transport::serialization {
 			const TransportCatalogue& transport_catalogue)
 		{
 			std::vector<domain::StopPtr> stops(std::move(transport_catalogue.GetAllStops()));
-			std::unordered_map<domain::StopPtr, size_t> stops_indexes;
-			for (size_t i = 0; i < stops.size(); ++i) {
-				stops_indexes[stops.at(i)] = i;
-			}
 			SerializeStops(stops, result_catalogue);
 
 			std::vector<domain::BusPtr> buses(std::move(transport_catalogue.GetAllRoutes()));
-			SerializeBuses(buses, stops_indexes, result_catalogue);
+			SerializeBuses(buses, transport_catalogue, result_catalogue);
 
 			std::vector<TransportCatalogue::Distance> distances = std::move(transport_catalogue.GetAllDistances());
 			std::sort(distances.begin(), distances.end(),
-				[&stops_indexes](auto lhs, auto rhs){
-					return std::tie(stops_indexes.at(lhs.from_stop), stops_indexes.at(lhs.to_stop))
-						< std::tie(stops_indexes.at(rhs.from_stop), stops_indexes.at(rhs.to_stop));
+				[](auto lhs, auto rhs){
+					return std::tie(lhs.from_stop, lhs.to_stop) < std::tie(rhs.from_stop, rhs.to_stop);
 				});
-			SerializeDistances (distances, stops_indexes, result_catalogue);
+			SerializeDistances (distances, result_catalogue);
 		}
 
 		data_base::Point SerializePoint(svg::Point point) {
@@ -126,11 +182,125 @@ namespace transport::serialization {
 			}
 		}
 
+		data_base::RouterStrategy SerializeRouterStrategy(graph::RouterStrategy strategy) {
+			switch (strategy) {
+				case graph::RouterStrategy::DIJKSTRA :
+					return data_base::RouterStrategy::DIJKSTRA;
+				case graph::RouterStrategy::CONTRACTION_HIERARCHY :
+					return data_base::RouterStrategy::CONTRACTION_HIERARCHY;
+				case graph::RouterStrategy::A_STAR :
+					return data_base::RouterStrategy::A_STAR;
+				case graph::RouterStrategy::ALL_PAIRS:
+				default:
+					return data_base::RouterStrategy::ALL_PAIRS;
+			}
+		}
+
 		void SerializeRouterSettings(data_base::RouterSettings & result_settings,
 			const TransportRouter::RouterSettings & router_settings)
 		{
 			result_settings.set_bus_wait_time(router_settings.bus_wait_time);
 			result_settings.set_bus_velocity(router_settings.bus_velocity);
+			result_settings.set_strategy(SerializeRouterStrategy(router_settings.strategy));
+			result_settings.set_threads(router_settings.threads);
+			result_settings.set_route_cache_size(router_settings.route_cache_size);
+			result_settings.set_landmark_count(router_settings.landmark_count);
+			result_settings.set_engine(router_settings.engine == TransportRouter::RouteEngine::RAPTOR
+				? data_base::RouteEngine::RAPTOR
+				: data_base::RouteEngine::GRAPH);
+			for (const auto & [name, profile] : router_settings.profiles) {
+				data_base::RoutingProfile & result_profile = (*result_settings.mutable_profiles())[name];
+				result_profile.set_bus_wait_time(profile.bus_wait_time);
+				result_profile.set_bus_velocity(profile.bus_velocity);
+			}
+			result_settings.set_profile_cache_size(router_settings.profile_cache_size);
+			result_settings.set_graph_model(router_settings.graph_model == TransportRouter::GraphModel::LINEAR
+				? data_base::GraphModel::LINEAR
+				: data_base::GraphModel::STOP_PAIRS);
+		}
+
+		data_base::EdgeType SerializeEdgeType(TransportRouter::EdgeType type) {
+			switch (type) {
+				case TransportRouter::EdgeType::BOARD :
+					return data_base::EdgeType::BOARD;
+				case TransportRouter::EdgeType::RIDE :
+					return data_base::EdgeType::RIDE;
+				case TransportRouter::EdgeType::ALIGHT :
+					return data_base::EdgeType::ALIGHT;
+				case TransportRouter::EdgeType::TRIP :
+				default:
+					return data_base::EdgeType::TRIP;
+			}
+		}
+
+		void SerializeTransportRouter(data_base::TransportRouter & result_router,
+			const TransportRouter & router, const TransportCatalogue & transport_catalogue)
+		{
+			// Удаленные маршруты не сохраняются, поэтому индекс маршрута в базе может быть меньше индекса в справочнике
+			const std::vector<domain::BusPtr> buses = transport_catalogue.GetAllRoutes();
+			std::vector<size_t> buses_indexes(buses.empty() ? 0 : buses.back()->id + 1);
+			for (size_t i = 0; i < buses.size(); ++i) {
+				buses_indexes[buses[i]->id] = i;
+			}
+
+			const TransportRouter::GraphData graph_data = router.GetGraphData();
+			data_base::Graph & result_graph = *result_router.mutable_graph();
+			result_graph.set_vertex_count(graph_data.vertices.size());
+			for (auto & edge : graph_data.edges) {
+				data_base::Edge & result_edge = *result_graph.add_edges();
+				result_edge.set_from(edge.from);
+				result_edge.set_to(edge.to);
+				result_edge.set_weight(edge.weight);
+			}
+
+			for (std::string_view stop_name : graph_data.vertices) {
+				auto stop = transport_catalogue.FindStop(stop_name);
+				result_router.add_vertex_stop_id(stop.has_value() ? stop.value()->id : transport_catalogue.GetStopCount());
+			}
+
+			result_router.set_dominated_edge_count(graph_data.dominated_edge_count);
+			for (auto & info : graph_data.edges_info) {
+				data_base::EdgeInfo & result_info = *result_router.add_edges_info();
+				result_info.set_bus_id(buses_indexes.at(transport_catalogue.FindRoute(info.bus_name).value()->id));
+				result_info.set_span_count(info.span_count);
+				result_info.set_type(SerializeEdgeType(info.type));
+				result_info.set_distance(info.distance);
+			}
+
+			if (const graph::HierarchyData<double> * hierarchy = router.GetHierarchyData()) {
+				data_base::ContractionHierarchy & result_hierarchy = *result_router.mutable_hierarchy();
+				for (uint32_t rank : hierarchy->ranks) {
+					result_hierarchy.add_ranks(rank);
+				}
+				for (auto & shortcut : hierarchy->shortcuts) {
+					data_base::Shortcut & result_shortcut = *result_hierarchy.add_shortcuts();
+					result_shortcut.set_from(shortcut.from);
+					result_shortcut.set_to(shortcut.to);
+					result_shortcut.set_weight(shortcut.weight);
+					result_shortcut.set_first(shortcut.first);
+					result_shortcut.set_second(shortcut.second);
+				}
+			}
+
+			if (const graph::LandmarksData<double> * landmarks = router.GetLandmarksData()) {
+				data_base::Landmarks & result_landmarks = *result_router.mutable_landmarks();
+				result_landmarks.mutable_vertices()->Add(landmarks->landmarks.begin(), landmarks->landmarks.end());
+				result_landmarks.mutable_from_landmarks()->Add(landmarks->from_landmarks.begin(),
+					landmarks->from_landmarks.end());
+				result_landmarks.mutable_to_landmarks()->Add(landmarks->to_landmarks.begin(),
+					landmarks->to_landmarks.end());
+			}
+		}
+
+		void WriteRoutesTable(std::ostream & output, uint64_t message_size,
+			const graph::RoutesTableView<double> & routes)
+		{
+			const uint64_t padding = GetRoutesTableOffset(message_size) - sizeof(FileHeader) - message_size;
+			const std::string zeros(padding, '\0');
+			output.write(zeros.data(), zeros.size());
+			const size_t cell_count = routes.vertex_count * routes.vertex_count;
+			output.write(reinterpret_cast<const char *>(routes.weights), cell_count * sizeof(double));
+			output.write(reinterpret_cast<const char *>(routes.prev_edges), cell_count * sizeof(uint32_t));
 		}
 
 		void DeserializeStops(const data_base::TransportCatalogue & loading_catalogue,
@@ -166,9 +336,20 @@ namespace transport::serialization {
 					stops.push_back(loading_catalogue.stops(bus.stops_id(i)).name());
 				}
 
+				std::optional<TransportCatalogue::RouteInfo> info;
+				if (bus.has_route_info()) {
+					const data_base::RouteInfo & loading_info = bus.route_info();
+					info = TransportCatalogue::RouteInfo{
+						static_cast<int>(loading_info.stops_count()),
+						static_cast<int>(loading_info.unique_stops_count()),
+						loading_info.length(),
+						loading_info.curvature() };
+				}
+
 				result.buses[bus.name()] = {
 					bus.is_looped(),
-					std::move(stops) };
+					std::move(stops),
+					info };
 			}
 		}
 
@@ -215,30 +396,151 @@ namespace transport::serialization {
 			}
 		}
 
+		TransportRouter::EdgeType DeserializeEdgeType(data_base::EdgeType type) {
+			switch (type) {
+				case data_base::EdgeType::BOARD :
+					return TransportRouter::EdgeType::BOARD;
+				case data_base::EdgeType::RIDE :
+					return TransportRouter::EdgeType::RIDE;
+				case data_base::EdgeType::ALIGHT :
+					return TransportRouter::EdgeType::ALIGHT;
+				case data_base::EdgeType::TRIP :
+				default:
+					return TransportRouter::EdgeType::TRIP;
+			}
+		}
+
+		void DeserializeTransportRouter(const data_base::TransportCatalogue & loading_catalogue,
+			const data_base::TransportRouter & loading_router, handler::RouteGraph & result)
+		{
+			const data_base::Graph & loading_graph = loading_router.graph();
+			result.vertices.reserve(loading_graph.vertex_count());
+			for (int i = 0; i < loading_router.vertex_stop_id_size(); ++i) {
+				const uint32_t stop_id = loading_router.vertex_stop_id(i);
+				result.vertices.push_back(static_cast<int>(stop_id) < loading_catalogue.stops_size()
+					? loading_catalogue.stops(stop_id).name()
+					: std::string{});
+			}
+
+			result.buses.reserve(loading_catalogue.buses_size());
+			for (int i = 0; i < loading_catalogue.buses_size(); ++i) {
+				result.buses.push_back(loading_catalogue.buses(i).name());
+			}
+
+			result.dominated_edge_count = loading_router.dominated_edge_count();
+			result.edges.reserve(loading_graph.edges_size());
+			for (int i = 0; i < loading_graph.edges_size(); ++i) {
+				const data_base::Edge & edge = loading_graph.edges(i);
+				const data_base::EdgeInfo & info = loading_router.edges_info(i);
+				result.edges.push_back({edge.from(), edge.to(), edge.weight(), info.bus_id(), info.span_count(),
+					DeserializeEdgeType(info.type()), info.distance()});
+			}
+
+			if (loading_router.has_hierarchy()) {
+				const data_base::ContractionHierarchy & loading_hierarchy = loading_router.hierarchy();
+				graph::HierarchyData<double> & hierarchy = result.precomputed.hierarchy.emplace();
+				hierarchy.ranks.assign(loading_hierarchy.ranks().begin(), loading_hierarchy.ranks().end());
+				hierarchy.shortcuts.reserve(loading_hierarchy.shortcuts_size());
+				for (auto & shortcut : loading_hierarchy.shortcuts()) {
+					hierarchy.shortcuts.push_back({shortcut.from(), shortcut.to(), shortcut.weight(),
+						shortcut.first(), shortcut.second()});
+				}
+			}
+
+			if (loading_router.has_landmarks()) {
+				const data_base::Landmarks & loading_landmarks = loading_router.landmarks();
+				graph::LandmarksData<double> & landmarks = result.precomputed.landmarks.emplace();
+				landmarks.landmarks.assign(loading_landmarks.vertices().begin(), loading_landmarks.vertices().end());
+				landmarks.from_landmarks.assign(loading_landmarks.from_landmarks().begin(),
+					loading_landmarks.from_landmarks().end());
+				landmarks.to_landmarks.assign(loading_landmarks.to_landmarks().begin(),
+					loading_landmarks.to_landmarks().end());
+			}
+		}
+
+		graph::RouterStrategy DeserializeRouterStrategy(data_base::RouterStrategy strategy) {
+			switch (strategy) {
+				case data_base::RouterStrategy::DIJKSTRA :
+					return graph::RouterStrategy::DIJKSTRA;
+				case data_base::RouterStrategy::CONTRACTION_HIERARCHY :
+					return graph::RouterStrategy::CONTRACTION_HIERARCHY;
+				case data_base::RouterStrategy::A_STAR :
+					return graph::RouterStrategy::A_STAR;
+				case data_base::RouterStrategy::ALL_PAIRS:
+				default:
+					return graph::RouterStrategy::ALL_PAIRS;
+			}
+		}
+
 		void DeserializeRouterSettings(const data_base::RouterSettings & loading_router_settings,
 			TransportRouter::RouterSettings & router_settings)
 		{
 			router_settings.bus_wait_time = loading_router_settings.bus_wait_time();
 			router_settings.bus_velocity = loading_router_settings.bus_velocity();
+			router_settings.strategy = DeserializeRouterStrategy(loading_router_settings.strategy());
+			router_settings.threads = loading_router_settings.threads();
+			router_settings.route_cache_size = loading_router_settings.route_cache_size();
+			router_settings.landmark_count = loading_router_settings.landmark_count();
+			router_settings.engine = loading_router_settings.engine() == data_base::RouteEngine::RAPTOR
+				? TransportRouter::RouteEngine::RAPTOR
+				: TransportRouter::RouteEngine::GRAPH;
+			for (const auto & [name, profile] : loading_router_settings.profiles()) {
+				router_settings.profiles[name] = {profile.bus_wait_time(), profile.bus_velocity()};
+			}
+			router_settings.profile_cache_size = loading_router_settings.profile_cache_size();
+			router_settings.graph_model = loading_router_settings.graph_model() == data_base::GraphModel::LINEAR
+				? TransportRouter::GraphModel::LINEAR
+				: TransportRouter::GraphModel::STOP_PAIRS;
 		}
 	}
 
-	void Serialize(Path file_name, const TransportCatalogue& transport_catalogue, const handler::InputResultGroup & settings) {
+	void Serialize(Path file_name, const TransportCatalogue& transport_catalogue, const TransportRouter& router,
+		const handler::InputResultGroup & settings)
+	{
 		std::ofstream output(file_name, std::ios::binary);
 		data_base::GeneralMessage result;
 
 		detail::SerializeTransportCatalogue(*result.mutable_transport_catalogue(), transport_catalogue);
 		detail::SerializeRendererSettings(*result.mutable_render_settings(), settings.render_settings);
 		detail::SerializeRouterSettings(*result.mutable_router_settings(), settings.router.settings);
+		// Без графа (RAPTOR) маршрутизатор собирается заново по справочнику при загрузке
+		const std::optional<graph::RoutesTableView<double>> routes = router.GetRoutesTable();
+		if (router.HasGraph()) {
+			detail::SerializeTransportRouter(*result.mutable_transport_router(), router, transport_catalogue);
+			result.mutable_transport_router()->set_has_routes_table(routes.has_value());
+		}
 
+		detail::FileHeader header;
+		std::memcpy(header.magic, detail::FILE_MAGIC, sizeof(header.magic));
+		header.message_size = result.ByteSizeLong();
+		output.write(reinterpret_cast<const char *>(&header), sizeof(header));
 		result.SerializeToOstream(&output);
+		if (routes.has_value()) {
+			detail::WriteRoutesTable(output, header.message_size, *routes);
+		}
 	}
 
 	std::optional<handler::InputResultGroup> Deserialize(Path file_name) {
-		std::ifstream input(file_name, std::ios_base::in | std::ios::binary);
+		const std::optional<detail::MappedFile> file = detail::MapFile(file_name);
+		if (!file.has_value()) {
+			return std::nullopt;
+		}
+		const char * data = static_cast<const char *>(file->data.get());
+
+		detail::FileHeader header;
+		const bool has_header = file->size >= sizeof(header)
+			&& std::memcmp(data, detail::FILE_MAGIC, sizeof(header.magic)) == 0;
+		if (has_header) {
+			std::memcpy(&header, data, sizeof(header));
+			if (header.message_size > file->size - sizeof(header)) {
+				return std::nullopt;
+			}
+		} else {
+			header.message_size = file->size;
+		}
 
 		data_base::GeneralMessage loading;
-		if (!loading.ParseFromIstream(&input)) {
+		if (!loading.ParseFromArray(has_header ? data + sizeof(header) : data, header.message_size)) {
 			return std::nullopt;
 		}
 
@@ -248,6 +550,29 @@ namespace transport::serialization {
 		detail::DeserializeRenderSettings(*loading.mutable_render_settings(), result.render_settings);
 		detail::DeserializeRouterSettings(*loading.mutable_router_settings(), result.router.settings);
 
+		if (loading.has_transport_router()) {
+			const data_base::TransportRouter & loading_router = loading.transport_router();
+			handler::RouteGraph & route_graph = result.router.graph.emplace();
+			detail::DeserializeTransportRouter(loading.transport_catalogue(), loading_router, route_graph);
+
+			if (has_header && loading_router.has_routes_table()) {
+				const uint64_t vertex_count = loading_router.graph().vertex_count();
+				const uint64_t offset = detail::GetRoutesTableOffset(header.message_size);
+				if (offset + detail::GetRoutesTableSize(vertex_count) > file->size) {
+					return std::nullopt;
+				}
+				const char * table = data + offset;
+				route_graph.precomputed.routes = TransportRouter::RoutesTable{
+					graph::RoutesTableView<double>{
+						vertex_count,
+						reinterpret_cast<const double *>(table),
+						reinterpret_cast<const uint32_t *>(table + vertex_count * vertex_count * sizeof(double))
+					},
+					file->data
+				};
+			}
+		}
+
 		return result;
 	}
 }
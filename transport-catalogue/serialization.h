@@ -10,6 +10,7 @@
 namespace transport::serialization {
 	using Path = std::filesystem::path;
 
-	void Serialize(Path file_name, const TransportCatalogue& catalogue, const handler::InputResultGroup & settings);
+	void Serialize(Path file_name, const TransportCatalogue& catalogue, const TransportRouter& router,
+		const handler::InputResultGroup & settings);
 	std::optional<handler::InputResultGroup> Deserialize(Path file_name);
 }
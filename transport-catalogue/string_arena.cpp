@@ -0,0 +1,56 @@
+#include "string_arena.h"
+
+#include <cstring>
+
+namespace arena {
+
+StringArena::StringArena(size_t block_size)
+	: block_size_(block_size) {}
+
+StringArena::StringId StringArena::Intern(std::string_view value) {
+	if (auto it = ids_.find(value); it != ids_.end()) {
+		return it->second;
+	}
+	const StringId id = static_cast<StringId>(strings_.size());
+	strings_.push_back(Store(value));
+	ids_.emplace(strings_.back(), id);
+	return id;
+}
+
+std::optional<StringArena::StringId> StringArena::Find(std::string_view value) const {
+	auto it = ids_.find(value);
+	if (it == ids_.end()) {
+		return std::nullopt;
+	}
+	return it->second;
+}
+
+std::string_view StringArena::Get(StringId id) const {
+	return strings_.at(id);
+}
+
+// Строка длиннее блока получает отдельный блок своего размера, и заполнение
+// текущего блока продолжается
+std::string_view StringArena::Store(std::string_view value) {
+	if (value.empty()) {
+		return {};
+	}
+	char* data = nullptr;
+	if (value.size() > block_size_) {
+		blocks_.push_back(std::make_unique<char[]>(value.size()));
+		data = blocks_.back().get();
+	} else {
+		if (block_used_ + value.size() > block_capacity_) {
+			blocks_.push_back(std::make_unique<char[]>(block_size_));
+			block_ = blocks_.back().get();
+			block_used_ = 0;
+			block_capacity_ = block_size_;
+		}
+		data = block_ + block_used_;
+		block_used_ += value.size();
+	}
+	std::memcpy(data, value.data(), value.size());
+	return {data, value.size()};
+}
+
+}  // namespace arena
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace arena {
+
+// Хранилище неизменяемых строк. Каждая строка хранится один раз и получает индекс,
+// строки лежат подряд в блоках памяти, на блок - одно выделение памяти.
+// Строки не перемещаются, поэтому string_view на них действительны, пока жив объект
+class StringArena {
+public:
+	using StringId = uint32_t;
+
+	explicit StringArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+	// Копия ссылалась бы на блоки оригинала
+	StringArena(const StringArena&) = delete;
+	StringArena& operator=(const StringArena&) = delete;
+
+	// Индекс строки, равной value. При первом добавлении строка копируется в хранилище
+	StringId Intern(std::string_view value);
+	std::optional<StringId> Find(std::string_view value) const;
+	std::string_view Get(StringId id) const;
+
+private:
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	std::string_view Store(std::string_view value);
+
+	size_t block_size_;
+	std::vector<std::unique_ptr<char[]>> blocks_;
+	size_t block_used_ = 0; // занято в последнем блоке обычного размера
+	size_t block_capacity_ = 0;
+	char* block_ = nullptr; // последний блок обычного размера
+	std::vector<std::string_view> strings_; // ключ - индекс строки
+	std::unordered_map<std::string_view, StringId> ids_;
+};
+
+}  // namespace arena
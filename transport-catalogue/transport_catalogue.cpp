@@ -1,129 +1,269 @@
 #include "transport_catalogue.h"
 
-#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
 
 namespace transport {
 	using geo::Coordinates;
 	void TransportCatalogue::AddStop(std::string_view name, Coordinates coord) {
 		// Проверка защищает от добавления дублей в stops_storage
-		if (stops.count(name)) {
+		if (FindStopByName(name)) {
 			return;
 		}
-		stops_storage.emplace_back(Stop{std::string(name), coord, {}});
-		stops[stops_storage.back().name] = &stops_storage.back();
+		const arena::StringArena::StringId name_id = names.Intern(name);
+		stops_storage.emplace_back(Stop{static_cast<StopId>(stops_storage.size()), names.Get(name_id), coord, {}});
+		if (stop_at_name.size() <= name_id) {
+			stop_at_name.resize(name_id + 1, nullptr);
+		}
+		stop_at_name[name_id] = &stops_storage.back();
 	}
 
 	std::optional<TransportCatalogue::StopPtr> TransportCatalogue::FindStop(std::string_view name) const {
-		if (stops.count(name)) {
-			return stops.at(name);
+		if (const Stop * stop = FindStopByName(name)) {
+			return stop;
 		}
 		return std::nullopt;
 	}
 
+	TransportCatalogue::StopPtr TransportCatalogue::GetStop(StopId id) const {
+		return &stops_storage.at(id);
+	}
+
 	std::vector<std::string_view> TransportCatalogue::GetBusesForStop(StopPtr stop) const {
-		std::vector<std::string_view> result;
-		result.reserve(stop->buses.size());
-		for (auto bus : stop->buses) {
-			result.push_back(bus);
+		return stop->buses;
+	}
+
+	void TransportCatalogue::SetStopDistance(StopId from, StopId to, int distance) {
+		// Заполнение таблицы не больше 3/4, иначе цепочки пробирования становятся длинными
+		if ((distance_count + 1) * 4 > distance_keys.size() * 3) {
+			GrowDistances();
 		}
-		return result;
+		const uint64_t key = MakeDistanceKey(from, to);
+		const size_t slot = FindDistanceSlot(key);
+		if (distance_keys[slot] == EMPTY_DISTANCE_KEY) {
+			distance_keys[slot] = key;
+			++distance_count;
+		}
+		distance_values[slot] = distance;
+
+		// Устарели только маршруты, где остановки соседние: расстояние в обратную сторону берется
+		// то же, поэтому порядок остановок не важен. Маршруты через from перечислены у остановки
+		for (std::string_view bus_name : stops_storage[from].buses) {
+			const Bus * bus = FindBusByName(bus_name);
+			for (size_t i = 1; i < bus->stops.size(); ++i) {
+				if ((bus->stops[i - 1] == from && bus->stops[i] == to)
+					|| (bus->stops[i - 1] == to && bus->stops[i] == from))
+				{
+					stale_buses.push_back(bus->id);
+					route_infos[bus->id].reset();
+					break;
+				}
+			}
+		}
+	}
+
+	// Расстояние в обратную сторону используется, только если в прямую оно не задано
+	int TransportCatalogue::GetStopDistance(StopId from, StopId to) const {
+		if (const int * distance = FindDistance(from, to)) {
+			return *distance;
+		}
+		if (const int * distance = FindDistance(to, from)) {
+			return *distance;
+		}
+		throw std::out_of_range("Distance between stops is not set");
+	}
+
+	uint64_t TransportCatalogue::MakeDistanceKey(StopId from, StopId to) {
+		return static_cast<uint64_t>(from) << 32 | to;
+	}
+
+	// Ячейка с ключом или первая свободная ячейка цепочки. Старшие биты произведения
+	// на нечетную константу перемешивают оба индекса
+	size_t TransportCatalogue::FindDistanceSlot(uint64_t key) const {
+		const size_t mask = distance_keys.size() - 1;
+		size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+		while (distance_keys[slot] != key && distance_keys[slot] != EMPTY_DISTANCE_KEY) {
+			slot = (slot + 1) & mask;
+		}
+		return slot;
 	}
 
-	void TransportCatalogue::SetStopDistance(StopPtr from, StopPtr to, int distance) {
-		stop_distances[{from, to}] = distance;
-		if (!stop_distances.count({to, from})) {
-			stop_distances[{to, from}] = distance;
+	const int * TransportCatalogue::FindDistance(StopId from, StopId to) const {
+		if (distance_keys.empty()) {
+			return nullptr;
 		}
+		const size_t slot = FindDistanceSlot(MakeDistanceKey(from, to));
+		return distance_keys[slot] == EMPTY_DISTANCE_KEY ? nullptr : &distance_values[slot];
 	}
 
-	int TransportCatalogue::GetStopDistance(StopPtr from, StopPtr to) const {
-		return stop_distances.at({from, to});
+	void TransportCatalogue::GrowDistances() {
+		std::vector<uint64_t> old_keys = std::move(distance_keys);
+		std::vector<int> old_values = std::move(distance_values);
+		const size_t capacity = old_keys.empty() ? 16 : old_keys.size() * 2;
+		distance_keys.assign(capacity, EMPTY_DISTANCE_KEY);
+		distance_values.assign(capacity, 0);
+		for (size_t i = 0; i < old_keys.size(); ++i) {
+			if (old_keys[i] != EMPTY_DISTANCE_KEY) {
+				const size_t slot = FindDistanceSlot(old_keys[i]);
+				distance_keys[slot] = old_keys[i];
+				distance_values[slot] = old_values[i];
+			}
+		}
 	}
 
 	int TransportCatalogue::GetStopCount() const {
-		return stops.size();
+		return stops_storage.size();
 	}
 
 	void TransportCatalogue::AddRoute(std::string_view name,
 		const std::vector<std::string> & route_stops, bool is_looped)
 	{
 		// Проверка защищает от добавления дублей в buses_storage
-		if (buses.count(name)) {
+		if (FindBusByName(name)) {
 			return;
 		}
-		Bus bus;
+		const arena::StringArena::StringId name_id = names.Intern(name);
+		Bus bus{};
+		bus.id = static_cast<BusId>(buses_storage.size());
 		bus.is_looped = is_looped;
-		bus.name = std::string(name);
+		bus.name = names.Get(name_id);
 		buses_storage.push_back(std::move(bus));
-		buses[buses_storage.back().name] = &buses_storage.back();
-		Bus & b = buses_storage.back();
-		if (is_looped) {
-			b.stops.reserve(route_stops.size());
-		} else {
-			b.stops.reserve(route_stops.size() * 2 - 1);
+		route_infos.emplace_back();
+		if (bus_at_name.size() <= name_id) {
+			bus_at_name.resize(name_id + 1, nullptr);
 		}
+		bus_at_name[name_id] = &buses_storage.back();
+		Bus & b = buses_storage.back();
+		b.stops.reserve(route_stops.size());
 		for (size_t i = 0; i < route_stops.size(); ++i) {
-			b.stops.push_back(stops[route_stops[i]]);
-			stops[route_stops[i]]->buses.insert(b.name);
+			Stop * stop = FindStopByName(route_stops[i]);
+			if (!stop) {
+				throw std::out_of_range("Stop is not found");
+			}
+			b.stops.push_back(stop->id);
+			auto position = std::lower_bound(stop->buses.begin(), stop->buses.end(), b.name);
+			if (position == stop->buses.end() || *position != b.name) {
+				stop->buses.insert(position, b.name);
+			}
 		}
 		b.start = b.stops.front();
 		b.finish = b.stops.back();
-		if (!is_looped) {
-			for (size_t i = b.stops.size() - 1; i > 0; --i) {
-				b.stops.push_back(b.stops[i - 1]);
+		ComputeBusDistances(b);
+	}
+
+	void TransportCatalogue::RemoveRoute(std::string_view name) {
+		const Bus * bus = FindBusByName(name);
+		if (!bus) {
+			return;
+		}
+		bus_at_name[*names.Find(name)] = nullptr;
+		for (StopId stop : bus->stops) {
+			std::vector<std::string_view> & stop_buses = stops_storage[stop].buses;
+			auto position = std::lower_bound(stop_buses.begin(), stop_buses.end(), bus->name);
+			if (position != stop_buses.end() && *position == bus->name) {
+				stop_buses.erase(position);
 			}
 		}
 	}
 
 	std::optional<TransportCatalogue::BusPtr> TransportCatalogue::FindRoute(std::string_view name) const {
-		if (buses.count(name)) {
-			return buses.at(name);
+		if (const Bus * bus = FindBusByName(name)) {
+			return bus;
 		}
 		return std::nullopt;
 	}
 
+	TransportCatalogue::BusPtr TransportCatalogue::GetRoute(BusId id) const {
+		return &buses_storage.at(id);
+	}
+
 	TransportCatalogue::RouteInfo TransportCatalogue::GetRouteInfo(BusPtr bus) const {
+		if (route_infos[bus->id].has_value()) {
+			return *route_infos[bus->id];
+		}
+		return ComputeRouteInfo(bus);
+	}
+
+	void TransportCatalogue::SetRouteInfo(BusPtr bus, RouteInfo info) {
+		route_infos[bus->id] = info;
+	}
+
+	void TransportCatalogue::ComputeRouteInfos() {
+		std::sort(stale_buses.begin(), stale_buses.end());
+		stale_buses.erase(std::unique(stale_buses.begin(), stale_buses.end()), stale_buses.end());
+		for (BusId bus_id : stale_buses) {
+			ComputeBusDistances(buses_storage[bus_id]);
+		}
+		stale_buses.clear();
+		for (BusPtr bus : GetAllRoutes()) {
+			if (!route_infos[bus->id].has_value()) {
+				route_infos[bus->id] = ComputeRouteInfo(bus);
+			}
+		}
+	}
+
+	TransportCatalogue::RouteInfo TransportCatalogue::ComputeRouteInfo(BusPtr bus) const {
 		RouteInfo result;
-		result.stops_count = bus->stops.size();
+		result.stops_count = bus->GetRouteStops().size();
 		result.unique_stops_count = GetUniqueStops(bus);
-		result.length = GetRealRouteLength(bus);
-		result.curvature = result.length / GetCoordinateRouteLength(bus);
+		result.length = bus->distances.back();
+		result.curvature = result.length / bus->geo_distances.back();
 		return result;
 	}
 
 	unsigned TransportCatalogue::GetUniqueStops(BusPtr bus) const {
-		std::unordered_set<StopPtr> result;
-		for (auto stop : bus->stops) {
-			result.insert(stop);
+		std::vector<StopId> result = bus->stops;
+		std::sort(result.begin(), result.end());
+		return std::unique(result.begin(), result.end()) - result.begin();
+	}
+
+	// Расстояния между соседними остановками ищутся один раз при добавлении маршрута
+	// и при изменении расстояния, дальше расстояние между любыми остановками - разность сумм
+	void TransportCatalogue::ComputeBusDistances(Bus & bus) const {
+		const domain::RouteStops route = bus.GetRouteStops();
+		bus.distances.assign(route.size(), 0);
+		bus.geo_distances.assign(route.size(), 0);
+		for (size_t i = 1; i < route.size(); ++i) {
+			bus.distances[i] = bus.distances[i - 1] + GetStopDistance(route[i - 1], route[i]);
+			bus.geo_distances[i] = bus.geo_distances[i - 1]
+				+ ComputeDistance(stops_storage[route[i - 1]].coordinates, stops_storage[route[i]].coordinates);
 		}
-		return result.size();
 	}
 
-	double TransportCatalogue::GetCoordinateRouteLength(BusPtr bus) const {
-		double sum = 0;
-		for (size_t i = 0; i < bus->stops.size() - 1; ++i) {
-			sum += ComputeDistance(bus->stops[i]->coordinates, bus->stops[i + 1]->coordinates);
+	// Название остановки и маршрута может совпадать: индекс названия общий, а таблицы разные
+	TransportCatalogue::Stop * TransportCatalogue::FindStopByName(std::string_view name) const {
+		const std::optional<arena::StringArena::StringId> name_id = names.Find(name);
+		if (!name_id || *name_id >= stop_at_name.size()) {
+			return nullptr;
 		}
-		return sum;
+		return stop_at_name[*name_id];
 	}
 
-	uint64_t TransportCatalogue::GetRealRouteLength(BusPtr bus) const {
-		uint64_t sum = 0;
-		for (size_t i = 0; i < bus->stops.size() - 1; ++i) {
-			sum += stop_distances.at({bus->stops[i], bus->stops[i + 1]});
+	TransportCatalogue::Bus * TransportCatalogue::FindBusByName(std::string_view name) const {
+		const std::optional<arena::StringArena::StringId> name_id = names.Find(name);
+		if (!name_id || *name_id >= bus_at_name.size()) {
+			return nullptr;
 		}
-		return sum;
+		return bus_at_name[*name_id];
 	}
 
-	size_t TransportCatalogue::PairStopsHasher::operator()(const std::pair<StopPtr, StopPtr>& stops) const {
-		return std::hash<const void*>{}(stops.first) * 37 + std::hash<const void*>{}(stops.second);
+	TransportCatalogue::SegmentDistance TransportCatalogue::GetSegmentDistance(BusPtr bus, size_t from,
+		size_t to) const
+	{
+		if (from > to || to >= bus->distances.size()) {
+			throw std::out_of_range("Stop index is out of route");
+		}
+		return {bus->distances[to] - bus->distances[from], bus->geo_distances[to] - bus->geo_distances[from]};
 	}
 
 	std::vector<TransportCatalogue::BusPtr> TransportCatalogue::GetAllRoutes() const {
 		std::vector<BusPtr> result;
 		result.reserve(buses_storage.size());
 		for (auto & bus: buses_storage) {
-			result.push_back(&bus);
+			// Удаленные маршруты остаются в хранилище
+			if (FindBusByName(bus.name) == &bus) {
+				result.push_back(&bus);
+			}
 		}
 		return result;
 	}
@@ -139,9 +279,12 @@ namespace transport {
 
 	std::vector<TransportCatalogue::Distance> TransportCatalogue::GetAllDistances() const {
 		std::vector<Distance> result;
-		result.reserve(stop_distances.size());
-		for (auto & [key, value]: stop_distances) {
-			result.push_back(Distance{key.first, key.second, value});
+		result.reserve(distance_count);
+		for (size_t i = 0; i < distance_keys.size(); ++i) {
+			if (distance_keys[i] != EMPTY_DISTANCE_KEY) {
+				const uint64_t key = distance_keys[i];
+				result.push_back(Distance{static_cast<StopId>(key >> 32), static_cast<StopId>(key), distance_values[i]});
+			}
 		}
 		return result;
 	}
@@ -1,13 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
-#include <unordered_map>
 #include <deque>
 #include <string>
 #include <optional>
 #include <utility>
 
 #include "domain.h"
+#include "string_arena.h"
 
 namespace transport {
 	class TransportCatalogue {
@@ -16,6 +17,8 @@ namespace transport {
 	public:
 		using StopPtr = domain::StopPtr;
 		using BusPtr = domain::BusPtr;
+		using StopId = domain::StopId;
+		using BusId = domain::BusId;
 
 		struct RouteInfo {
 			int stops_count;
@@ -23,41 +26,81 @@ namespace transport {
 			uint64_t length; //расстояние между остановками по дороге
 			double curvature; //извилистость
 		};
+		struct SegmentDistance {
+			uint64_t length; //по дороге
+			double geo_length; //по прямой между соседними остановками
+		};
 
 		void AddStop(std::string_view name, geo::Coordinates coord);
 		std::optional<StopPtr> FindStop(std::string_view name) const;
+		// Поиск по названию нужен только на входе, дальше остановка и маршрут передаются индексами
+		StopPtr GetStop(StopId id) const;
 		std::vector<std::string_view> GetBusesForStop(StopPtr stop) const;
-		void SetStopDistance(StopPtr from, StopPtr to, int distance);
-		int GetStopDistance(StopPtr from, StopPtr to) const;
+		// Маршруты, у которых from и to - соседние остановки, пересчитываются в ComputeRouteInfos:
+		// до ее вызова их расстояния и характеристики устаревшие
+		void SetStopDistance(StopId from, StopId to, int distance);
+		int GetStopDistance(StopId from, StopId to) const;
 		int GetStopCount() const;
+		// Ключ - индекс остановки
 		std::vector<StopPtr> GetAllStops() const;
 
 		void AddRoute(std::string_view name, const std::vector<std::string> & stops,
 			bool is_looped);
+		// Данные маршрута остаются в хранилище: указатели на него и на его название не становятся
+		// недействительными, но маршрут больше не находится и не входит в GetAllRoutes
+		void RemoveRoute(std::string_view name);
 		std::optional<BusPtr> FindRoute(std::string_view name) const;
+		// Удаленные маршруты тоже доступны по индексу
+		BusPtr GetRoute(BusId id) const;
+		// Характеристики маршрута считаются один раз: при создании базы или из нее же загружаются,
+		// и пересчитываются при изменении расстояния между соседними остановками маршрута.
+		// Для маршрута без готовых характеристик они вычисляются при каждом вызове
 		RouteInfo GetRouteInfo(BusPtr bus) const;
+		void SetRouteInfo(BusPtr bus, RouteInfo info);
+		// Пересчитывает расстояния маршрутов, затронутых SetStopDistance, и вычисляет характеристики
+		// маршрутов, для которых они не заданы
+		void ComputeRouteInfos();
 		std::vector<BusPtr> GetAllRoutes() const;
+		// Расстояние по маршруту от остановки с индексом from до остановки to в bus->GetRouteStops(), from <= to
+		SegmentDistance GetSegmentDistance(BusPtr bus, size_t from, size_t to) const;
 
 		struct Distance {
-			StopPtr from_stop;
-			StopPtr to_stop;
+			StopId from_stop;
+			StopId to_stop;
 			int distance;
 		};
+		// Только заданные расстояния: обратное направление, взятое по умолчанию, не повторяется
 		std::vector<Distance> GetAllDistances()const;
 
 	private:
+		// Названия остановок и маршрутов, на них ссылаются все остальные данные. Поиск по названию -
+		// единственный поиск по строке: дальше остановка и маршрут находятся по индексу названия
+		arena::StringArena names;
 		std::deque<Stop> stops_storage;
 		std::deque<Bus> buses_storage;
-		std::unordered_map<std::string_view, Stop*> stops;
-		std::unordered_map<std::string_view, Bus*> buses;
+		// Ключ - индекс названия в names, nullptr - остановки (маршрута) с таким названием нет
+		std::vector<Stop*> stop_at_name;
+		std::vector<Bus*> bus_at_name;
+		std::vector<std::optional<RouteInfo>> route_infos; // ключ - индекс маршрута
+		std::vector<BusId> stale_buses; // маршруты с измененными расстояниями, возможны повторы
 
-		struct PairStopsHasher {
-			size_t operator()(const std::pair<StopPtr, StopPtr>& stops) const;
-		};
-		std::unordered_map<std::pair<StopPtr, StopPtr>, int, PairStopsHasher> stop_distances;
+		// Расстояния хранятся только в заданном направлении, обратное ищется при чтении.
+		// Открытая адресация с линейным пробированием: ключ - индексы остановок from и to
+		// в старших и младших 32 битах, свободная ячейка - EMPTY_DISTANCE_KEY. Размер - степень двойки
+		std::vector<uint64_t> distance_keys;
+		std::vector<int> distance_values;
+		size_t distance_count = 0;
+
+		static constexpr uint64_t EMPTY_DISTANCE_KEY = UINT64_MAX;
+		static uint64_t MakeDistanceKey(StopId from, StopId to);
+		size_t FindDistanceSlot(uint64_t key) const;
+		const int * FindDistance(StopId from, StopId to) const;
+		void GrowDistances();
 
+		RouteInfo ComputeRouteInfo(BusPtr bus) const;
 		unsigned GetUniqueStops(BusPtr bus) const;
-		double GetCoordinateRouteLength(BusPtr bus) const;
-		uint64_t GetRealRouteLength(BusPtr bus) const;
+		void ComputeBusDistances(Bus & bus) const;
+		Stop * FindStopByName(std::string_view name) const;
+		Bus * FindBusByName(std::string_view name) const;
 	};
 }
@@ -1,96 +1,987 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <tuple>
+
 namespace transport {
+	namespace {
+		double ToMetersPerMinute(double kilometers_per_hour) {
+			constexpr double conversion_rate = 1000.0 / 60.0;
+			return kilometers_per_hour * conversion_rate;
+		}
+	}
+
 	void TransportRouter::Init(RouterSettings settings, const TransportCatalogue & catalogue) {
+		router_ = nullptr;
+		routes_storage_ = nullptr;
+		raptor_ = nullptr;
 		SetSettings(settings);
+		route_cache_.Reset(settings_.route_cache_size);
+		profile_cache_.Reset(settings_.profile_cache_size);
+		if (settings_.engine == RouteEngine::RAPTOR) {
+			graph_ = nullptr;
+			vertex_id_at_stop_.clear();
+			vertex_name_at_id_.clear();
+			edges_info_.clear();
+			vertex_coordinates_.clear();
+			raptor_ = std::make_unique<Raptor>(catalogue, settings_.bus_wait_time, settings_.bus_velocity);
+			return;
+		}
 		MakeGraph(catalogue);
-		router_ = std::make_unique<graph::Router<Weight>>(graph::Router{*graph_});
+		MakeRouter();
+	}
+
+	void TransportRouter::Init(RouterSettings settings, GraphData graph_data, Precomputed precomputed) {
+		router_ = nullptr;
+		routes_storage_ = nullptr;
+		raptor_ = nullptr;
+		SetSettings(settings);
+		route_cache_.Reset(settings_.route_cache_size);
+		profile_cache_.Reset(settings_.profile_cache_size);
+
+		// Вершины остановок, через которые не проходит ни один автобус, не имеют названия и остановки
+		vertex_id_at_stop_.clear();
+		for (size_t id = 0; id < graph_data.stops.size(); ++id) {
+			if (graph_data.stops[id].has_value()) {
+				const domain::StopId stop = *graph_data.stops[id];
+				if (vertex_id_at_stop_.size() <= stop) {
+					vertex_id_at_stop_.resize(stop + 1, NO_VERTEX);
+				}
+				vertex_id_at_stop_[stop] = id;
+			}
+		}
+		vertex_name_at_id_ = std::move(graph_data.vertices);
+		graph_ = std::make_unique<Graph>(vertex_name_at_id_.size(), std::move(graph_data.edges));
+		edges_info_ = std::move(graph_data.edges_info);
+		dominated_edge_count_ = graph_data.dominated_edge_count;
+		vertex_coordinates_ = std::move(graph_data.coordinates);
+		CompleteVertexCoordinates();
+
+		if (precomputed.routes.has_value() && settings_.strategy == graph::RouterStrategy::ALL_PAIRS) {
+			routes_storage_ = std::move(precomputed.routes->storage);
+			router_ = std::make_unique<graph::Router<Weight>>(*graph_, precomputed.routes->view, settings_.threads);
+		} else if (precomputed.hierarchy.has_value()
+			&& settings_.strategy == graph::RouterStrategy::CONTRACTION_HIERARCHY)
+		{
+			router_ = std::make_unique<graph::Router<Weight>>(*graph_, std::move(*precomputed.hierarchy));
+		} else if (settings_.strategy == graph::RouterStrategy::A_STAR) {
+			router_ = precomputed.landmarks.has_value()
+				? std::make_unique<graph::Router<Weight>>(*graph_, MakeLowerBound(), std::move(*precomputed.landmarks))
+				: std::make_unique<graph::Router<Weight>>(*graph_, MakeLowerBound(), settings_.landmark_count);
+		} else {
+			MakeRouter();
+		}
+	}
+
+	void TransportRouter::MakeRouter() {
+		router_ = nullptr;
+		routes_storage_ = nullptr;
+		if (settings_.strategy == graph::RouterStrategy::A_STAR) {
+			router_ = std::make_unique<graph::Router<Weight>>(*graph_, MakeLowerBound(), settings_.landmark_count);
+		} else {
+			router_ = std::make_unique<graph::Router<Weight>>(*graph_, settings_.strategy, settings_.threads);
+		}
+	}
+
+	void TransportRouter::AddBus(const TransportCatalogue & catalogue, std::string_view name) {
+		route_cache_.Clear();
+		profile_cache_.Clear();
+		if (raptor_) {
+			raptor_ = std::make_unique<Raptor>(catalogue, settings_.bus_wait_time, settings_.bus_velocity);
+			return;
+		}
+		const std::optional<domain::BusPtr> bus = catalogue.FindRoute(name);
+		if (!bus.has_value() || (*bus)->stops.size() < 2) {
+			return;
+		}
+		// Новые остановки получают вершины в конце графа
+		UpdateStopVertices(catalogue);
+		for (domain::StopId stop_id : (*bus)->stops) {
+			graph::VertexId & vertex = vertex_id_at_stop_[stop_id];
+			if (vertex == NO_VERTEX) {
+				vertex = vertex_name_at_id_.size();
+				vertex_name_at_id_.emplace_back();
+				vertex_coordinates_.emplace_back();
+			}
+			const domain::StopPtr stop = catalogue.GetStop(stop_id);
+			if (AddVertex(vertex, stop->name)) {
+				vertex_coordinates_[vertex] = stop->coordinates;
+			}
+		}
+		std::vector<graph::Edge<Weight>> edges;
+		const size_t first_new_edge = graph_->GetEdgeCount();
+		AddBusEdges(*bus, edges);
+		RemoveDominatedEdges(edges, first_new_edge);
+
+		// Между парой вершин остается одно ребро, как и при полном построении: более медленное
+		// ребро графа удаляется, а описания новых ребер переносятся в конец после удаления
+		const std::vector<bool> is_replaced = RemoveEdgesDominatedByGraph(edges, first_new_edge);
+		std::vector<EdgeInfo> new_edges_info(edges_info_.begin() + first_new_edge, edges_info_.end());
+		edges_info_.resize(first_new_edge);
+		const bool is_updatable = settings_.strategy == graph::RouterStrategy::ALL_PAIRS
+			|| settings_.strategy == graph::RouterStrategy::DIJKSTRA;
+		if (std::find(is_replaced.begin(), is_replaced.end(), true) != is_replaced.end()) {
+			const std::vector<std::optional<graph::EdgeId>> new_edge_ids = RemoveGraphEdges(
+				[&is_replaced](graph::EdgeId edge_id) {
+					return is_replaced[edge_id];
+				});
+			if (is_updatable) {
+				router_->RemoveEdges(new_edge_ids);
+			}
+		}
+		std::move(new_edges_info.begin(), new_edges_info.end(), std::back_inserter(edges_info_));
+		graph_->AddVertices(vertex_name_at_id_.size() - graph_->GetVertexCount());
+		const graph::EdgeId first_edge = graph_->AddEdges(std::move(edges));
+		dominated_edge_count_ = CountBusEdges(catalogue) - graph_->GetEdgeCount();
+
+		if (is_updatable) {
+			router_->AddEdges(first_edge);
+		} else {
+			MakeRouter();
+		}
+	}
+
+	void TransportRouter::RemoveBus(const TransportCatalogue & catalogue, std::string_view name) {
+		route_cache_.Clear();
+		profile_cache_.Clear();
+		if (raptor_) {
+			raptor_ = std::make_unique<Raptor>(catalogue, settings_.bus_wait_time, settings_.bus_velocity);
+			return;
+		}
+		std::vector<std::pair<graph::VertexId, graph::VertexId>> removed_pairs;
+		for (graph::EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+			if (edges_info_[edge_id].bus_name == name) {
+				removed_pairs.emplace_back(graph_->GetEdge(edge_id).from, graph_->GetEdge(edge_id).to);
+			}
+		}
+		if (removed_pairs.empty()) {
+			return;
+		}
+		const std::vector<std::optional<graph::EdgeId>> new_edge_ids = RemoveGraphEdges(
+			[this, name](graph::EdgeId edge_id) {
+				return edges_info_[edge_id].bus_name == name;
+			});
+		const graph::EdgeId first_restored_edge = graph_->AddEdges(RestoreDominatedEdges(catalogue, name, removed_pairs));
+		dominated_edge_count_ = CountBusEdges(catalogue) - graph_->GetEdgeCount();
+
+		// Остановка, через которую больше не проходит ни один маршрут, перестает находиться, как и при
+		// построении графа. Ее вершина остается в графе без ребер, чтобы не перенумеровывать остальные
+		std::vector<bool> has_edges(graph_->GetVertexCount(), false);
+		for (const auto & edge : graph_->GetEdges()) {
+			has_edges[edge.from] = true;
+			has_edges[edge.to] = true;
+		}
+		for (graph::VertexId vertex = 0; vertex < vertex_name_at_id_.size(); ++vertex) {
+			if (!has_edges[vertex] && !vertex_name_at_id_[vertex].empty()) {
+				vertex_name_at_id_[vertex] = {};
+			}
+		}
+
+		if (settings_.strategy == graph::RouterStrategy::ALL_PAIRS
+			|| settings_.strategy == graph::RouterStrategy::DIJKSTRA)
+		{
+			router_->RemoveEdges(new_edge_ids);
+			router_->AddEdges(first_restored_edge);
+		} else {
+			MakeRouter();
+		}
+	}
+
+	// Удаляет ребра графа вместе с их описаниями, порядок остальных ребер сохраняется
+	std::vector<std::optional<graph::EdgeId>> TransportRouter::RemoveGraphEdges(
+		const std::function<bool(graph::EdgeId)> & is_removed)
+	{
+		const std::vector<std::optional<graph::EdgeId>> new_edge_ids = graph_->RemoveEdges(is_removed);
+		for (graph::EdgeId edge_id = 0; edge_id < new_edge_ids.size(); ++edge_id) {
+			if (new_edge_ids[edge_id]) {
+				edges_info_[*new_edge_ids[edge_id]] = edges_info_[edge_id];
+			}
+		}
+		edges_info_.resize(graph_->GetEdgeCount());
+		return new_edge_ids;
+	}
+
+	// Новые ребра edges (описания - с edges_info_[first_edge]) сравниваются с ребрами графа между теми же
+	// вершинами. При равенстве остается ребро графа: при полном построении маршрут добавлен бы последним.
+	// Проигравшие новые ребра удаляются из edges, для ребер графа возвращается отметка, ключ - номер ребра
+	std::vector<bool> TransportRouter::RemoveEdgesDominatedByGraph(std::vector<graph::Edge<Weight>> & edges,
+		size_t first_edge)
+	{
+		std::vector<bool> is_replaced(graph_->GetEdgeCount(), false);
+		size_t kept_count = 0;
+		for (size_t i = 0; i < edges.size(); ++i) {
+			bool is_dominated = false;
+			// У новых вершин ребер в графе еще нет
+			if (edges[i].from < graph_->GetVertexCount()) {
+				for (graph::EdgeId edge_id : graph_->GetIncidentEdges(edges[i].from)) {
+					const auto & edge = graph_->GetEdge(edge_id);
+					if (edge.to != edges[i].to) {
+						continue;
+					}
+					if (IsFasterEdge(edges[i], edges_info_[first_edge + i], edge, edges_info_[edge_id])) {
+						is_replaced[edge_id] = true;
+					} else {
+						is_dominated = true;
+					}
+				}
+			}
+			if (!is_dominated) {
+				edges[kept_count] = edges[i];
+				edges_info_[first_edge + kept_count] = edges_info_[first_edge + i];
+				++kept_count;
+			}
+		}
+		edges.resize(kept_count);
+		edges_info_.resize(first_edge + kept_count);
+		return is_replaced;
+	}
+
+	// Число ребер, которые строятся для маршрутов справочника до удаления доминируемых
+	size_t TransportRouter::CountBusEdges(const TransportCatalogue & catalogue) const {
+		size_t result = 0;
+		for (domain::BusPtr bus : catalogue.GetAllRoutes()) {
+			if (bus->stops.size() < 2) {
+				continue;
+			}
+			const size_t stop_count = bus->GetRouteStops().size();
+			result += settings_.graph_model == GraphModel::LINEAR
+				? 3 * (stop_count - 1)
+				: stop_count * (stop_count - 1) / 2;
+		}
+		return result;
 	}
 
 	void TransportRouter::SetSettings(RouterSettings settings) {
 		settings_.bus_wait_time = settings.bus_wait_time;
-		constexpr double conversion_rate = 1000.0 / 60.0; // км/ч переводим в м/мин
-		settings_.bus_velocity = settings.bus_velocity * conversion_rate;
+		settings_.bus_velocity = ToMetersPerMinute(settings.bus_velocity);
+		default_profile_ = {settings.bus_wait_time, settings.bus_velocity};
+		settings_.strategy = settings.strategy;
+		settings_.threads = settings.threads;
+		settings_.graph_model = settings.graph_model;
+		settings_.route_cache_size = settings.route_cache_size;
+		settings_.landmark_count = settings.landmark_count;
+		settings_.engine = settings.engine;
+		settings_.profiles = std::move(settings.profiles);
+		settings_.profile_cache_size = settings.profile_cache_size;
 	}
 
+	// Вершина остановки - ее индекс в каталоге, вершины "в автобусе" модели LINEAR идут следом
+	// по порядку маршрутов. Маршруты независимы, поэтому их ребра строятся параллельно в отдельные
+	// буферы и склеиваются по порядку маршрутов: номера ребер не зависят от числа потоков
 	void TransportRouter::MakeGraph(const TransportCatalogue & catalogue) {
-		graph_ = std::make_unique<Graph>(Graph{static_cast<size_t>(catalogue.GetStopCount())});
-		vertex_name_at_id_.resize(catalogue.GetStopCount());
-		std::vector<domain::BusPtr> all_routes = catalogue.GetAllRoutes();
-		int last_vertex_id = 0;
-		for (auto bus_ptr : all_routes) {
-			for (int i = 0; i < static_cast<int>(bus_ptr->stops.size()); ++i) {
-				int distance = 0;
-				domain::StopPtr from_stop = bus_ptr->stops.at(i);
-				for (int j = i + 1; j < static_cast<int>(bus_ptr->stops.size()); ++j) {
-					domain::StopPtr prev_stop = bus_ptr->stops.at(j-1);
-					domain::StopPtr to_stop = bus_ptr->stops.at(j);
-					distance += catalogue.GetStopDistance(prev_stop, to_stop);
-
-					if (AddVertex(last_vertex_id, from_stop->name)) {
-						++last_vertex_id;
-					}
-					if (AddVertex(last_vertex_id, to_stop->name)) {
-						++last_vertex_id;
-					}
+		const std::vector<domain::StopPtr> all_stops = catalogue.GetAllStops();
+		vertex_name_at_id_.assign(all_stops.size(), {});
+		edges_info_.clear();
+		vertex_coordinates_.assign(all_stops.size(), std::nullopt);
+		vertex_id_at_stop_.resize(all_stops.size());
+		std::iota(vertex_id_at_stop_.begin(), vertex_id_at_stop_.end(), 0);
+
+		std::vector<domain::BusPtr> buses;
+		std::vector<graph::VertexId> first_ride_vertices;
+		size_t vertex_count = all_stops.size();
+		for (auto bus_ptr : catalogue.GetAllRoutes()) {
+			if (bus_ptr->stops.size() < 2) {
+				continue;
+			}
+			// Имя получают только вершины остановок, через которые проходят маршруты
+			for (domain::StopId id : bus_ptr->stops) {
+				if (vertex_name_at_id_[id].empty()) {
+					AddVertex(id, all_stops[id]->name);
+					vertex_coordinates_[id] = all_stops[id]->coordinates;
+				}
+			}
+			buses.push_back(bus_ptr);
+			first_ride_vertices.push_back(vertex_count);
+			if (settings_.graph_model == GraphModel::LINEAR) {
+				vertex_count += bus_ptr->GetRouteStops().size();
+			}
+		}
+		vertex_name_at_id_.resize(vertex_count);
+		vertex_coordinates_.resize(vertex_count);
+		if (settings_.graph_model == GraphModel::LINEAR) {
+			for (size_t i = 0; i < buses.size(); ++i) {
+				SetRideVertexCoordinates(buses[i], first_ride_vertices[i]);
+			}
+		}
+
+		std::vector<BusEdges> bus_edges(buses.size());
+		std::atomic<size_t> next_bus = 0;
+		const auto make_bus_edges = [&]() {
+			for (size_t i = next_bus++; i < buses.size(); i = next_bus++) {
+				MakeBusEdges(buses[i], first_ride_vertices[i], bus_edges[i]);
+			}
+		};
+		const size_t thread_count = settings_.threads == 0
+			? std::max(1u, std::thread::hardware_concurrency())
+			: settings_.threads;
+		std::vector<std::thread> threads;
+		for (size_t thread_index = 1; thread_index < std::min(thread_count, buses.size()); ++thread_index) {
+			threads.emplace_back(make_bus_edges);
+		}
+		make_bus_edges();
+		for (auto & thread : threads) {
+			thread.join();
+		}
+
+		size_t edge_count = 0;
+		for (const BusEdges & current : bus_edges) {
+			edge_count += current.edges.size();
+		}
+		std::vector<graph::Edge<Weight>> edges;
+		edges.reserve(edge_count);
+		edges_info_.reserve(edge_count);
+		for (BusEdges & current : bus_edges) {
+			edges.insert(edges.end(), current.edges.begin(), current.edges.end());
+			std::move(current.info.begin(), current.info.end(), std::back_inserter(edges_info_));
+			current = {};
+		}
+		dominated_edge_count_ = RemoveDominatedEdges(edges, 0);
+		graph_ = std::make_unique<Graph>(vertex_name_at_id_.size(), std::move(edges));
+	}
+
+	// Вершины всех остановок маршрута уже созданы, новые вершины "в автобусе" добавляются в конец
+	void TransportRouter::AddBusEdges(domain::BusPtr bus, std::vector<graph::Edge<Weight>> & edges) {
+		const graph::VertexId first_ride_vertex = vertex_name_at_id_.size();
+		if (settings_.graph_model == GraphModel::LINEAR) {
+			vertex_name_at_id_.resize(first_ride_vertex + bus->GetRouteStops().size());
+			vertex_coordinates_.resize(vertex_name_at_id_.size());
+			SetRideVertexCoordinates(bus, first_ride_vertex);
+		}
+		BusEdges bus_edges;
+		MakeBusEdges(bus, first_ride_vertex, bus_edges);
+		edges.insert(edges.end(), bus_edges.edges.begin(), bus_edges.edges.end());
+		std::move(bus_edges.info.begin(), bus_edges.info.end(), std::back_inserter(edges_info_));
+	}
+
+	// Не меняет состояние маршрутизатора и вызывается из нескольких потоков. Вершины остановок
+	// ищутся один раз на маршрут, расстояния берутся из накопленных сумм маршрута
+	void TransportRouter::MakeBusEdges(domain::BusPtr bus, graph::VertexId first_ride_vertex, BusEdges & result) const {
+		const domain::RouteStops route = bus->GetRouteStops();
+		std::vector<graph::VertexId> stop_vertices;
+		stop_vertices.reserve(route.size());
+		for (domain::StopId stop : route) {
+			stop_vertices.push_back(vertex_id_at_stop_[stop]);
+		}
+
+		if (settings_.graph_model == GraphModel::LINEAR) {
+			AddLinearEdges(bus, stop_vertices, first_ride_vertex, result);
+		} else {
+			AddStopPairsEdges(bus, stop_vertices, result);
+		}
+	}
+
+	// Вершина "в автобусе" расположена там же, где остановка на той же позиции маршрута.
+	// Вершины остановок маршрута уже созданы и имеют координаты
+	void TransportRouter::SetRideVertexCoordinates(domain::BusPtr bus, graph::VertexId first_ride_vertex) {
+		const domain::RouteStops route = bus->GetRouteStops();
+		for (size_t i = 0; i < route.size(); ++i) {
+			vertex_coordinates_[first_ride_vertex + i] = vertex_coordinates_[vertex_id_at_stop_[route[i]]];
+		}
+	}
+
+	// Для графа из базы маршрутов нет: вершина "в автобусе" связана со своей остановкой
+	// ребрами посадки и выхода, а ребро поездки ведет к вершине следующей остановки
+	void TransportRouter::CompleteVertexCoordinates() {
+		vertex_coordinates_.resize(graph_->GetVertexCount());
+		for (graph::EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+			const auto & edge = graph_->GetEdge(edge_id);
+			if (edges_info_[edge_id].type == EdgeType::BOARD && !vertex_coordinates_[edge.to]) {
+				vertex_coordinates_[edge.to] = vertex_coordinates_[edge.from];
+			} else if (edges_info_[edge_id].type == EdgeType::ALIGHT && !vertex_coordinates_[edge.from]) {
+				vertex_coordinates_[edge.from] = vertex_coordinates_[edge.to];
+			}
+		}
+	}
+
+	// Скорость автобусов одинакова, но расстояния по дорогам задаются вручную и могут быть меньше
+	// расстояний по прямой. Поэтому минимальное время на метр по прямой берется по всем ребрам:
+	// тогда вес любого ребра не меньше оценки, а по неравенству треугольника и вес любого пути
+	graph::LowerBound<TransportRouter::Weight> TransportRouter::MakeLowerBound() const {
+		std::optional<double> time_per_meter;
+		for (const auto & edge : graph_->GetEdges()) {
+			const auto & from = vertex_coordinates_[edge.from];
+			const auto & to = vertex_coordinates_[edge.to];
+			if (!from || !to) {
+				continue;
+			}
+			const double distance = geo::ComputeDistance(*from, *to);
+			if (distance > 0 && (!time_per_meter || edge.weight / distance < *time_per_meter)) {
+				time_per_meter = edge.weight / distance;
+			}
+		}
+		if (!time_per_meter || *time_per_meter <= 0) {
+			return {};
+		}
+		// Запас на погрешность вычислений с плавающей точкой
+		const double factor = *time_per_meter * (1 - 1e-9);
+		return [this, factor](graph::VertexId from, graph::VertexId to) {
+			const auto & from_coordinates = vertex_coordinates_[from];
+			const auto & to_coordinates = vertex_coordinates_[to];
+			if (!from_coordinates || !to_coordinates) {
+				return 0.0;
+			}
+			const double distance = geo::ComputeDistance(*from_coordinates, *to_coordinates);
+			return distance > 0 ? distance * factor : 0.0;
+		};
+	}
+
+	void TransportRouter::AddStopPairsEdges(domain::BusPtr bus, const std::vector<graph::VertexId> & stop_vertices,
+		BusEdges & result) const
+	{
+		const size_t stop_count = stop_vertices.size();
+		result.edges.reserve(result.edges.size() + stop_count * (stop_count - 1) / 2);
+		result.info.reserve(result.info.size() + stop_count * (stop_count - 1) / 2);
+		for (size_t i = 0; i < stop_count; ++i) {
+			for (size_t j = i + 1; j < stop_count; ++j) {
+				const int distance = static_cast<int>(bus->distances[j] - bus->distances[i]);
+				result.info.push_back(EdgeInfo{bus->name, static_cast<int>(j - i), EdgeType::TRIP, distance});
+				result.edges.push_back(graph::Edge<Weight>{
+					stop_vertices[i],
+					stop_vertices[j],
+					ComputeEdgeWeight(result.info.back(), settings_.bus_wait_time, settings_.bus_velocity)
+				});
+			}
+		}
+	}
+
+	// Для каждой остановки маршрута заводится вершина "в автобусе". Посадка стоит времени ожидания,
+	// переезд к следующей остановке - времени в пути, выход бесплатный
+	void TransportRouter::AddLinearEdges(domain::BusPtr bus, const std::vector<graph::VertexId> & stop_vertices,
+		graph::VertexId first_ride_vertex, BusEdges & result) const
+	{
+		for (size_t i = 0; i < stop_vertices.size(); ++i) {
+			const graph::VertexId ride_vertex = first_ride_vertex + i;
+			if (i + 1 < stop_vertices.size()) {
+				result.info.push_back(EdgeInfo{bus->name, 0, EdgeType::BOARD});
+				result.edges.push_back(graph::Edge<Weight>{stop_vertices[i], ride_vertex,
+					ComputeEdgeWeight(result.info.back(), settings_.bus_wait_time, settings_.bus_velocity)});
+				result.info.push_back(EdgeInfo{bus->name, 1, EdgeType::RIDE,
+					static_cast<int>(bus->distances[i + 1] - bus->distances[i])});
+				result.edges.push_back(graph::Edge<Weight>{ride_vertex, ride_vertex + 1,
+					ComputeEdgeWeight(result.info.back(), settings_.bus_wait_time, settings_.bus_velocity)});
+			}
+			if (i > 0) {
+				result.info.push_back(EdgeInfo{bus->name, 0, EdgeType::ALIGHT});
+				result.edges.push_back(graph::Edge<Weight>{ride_vertex, stop_vertices[i],
+					ComputeEdgeWeight(result.info.back(), settings_.bus_wait_time, settings_.bus_velocity)});
+			}
+		}
+	}
+
+	// bus_velocity - метры в минуту
+	TransportRouter::Weight TransportRouter::ComputeEdgeWeight(const EdgeInfo & info, int bus_wait_time,
+		double bus_velocity)
+	{
+		switch (info.type) {
+			case EdgeType::BOARD :
+				return static_cast<Weight>(bus_wait_time);
+			case EdgeType::RIDE :
+				return 1.0 * info.distance / bus_velocity;
+			case EdgeType::ALIGHT :
+				return 0;
+			case EdgeType::TRIP :
+			default:
+				return 1.0 * info.distance / bus_velocity + bus_wait_time;
+		}
+	}
+
+	bool TransportRouter::IsFasterEdge(const graph::Edge<Weight> & lhs, const EdgeInfo & lhs_info,
+		const graph::Edge<Weight> & rhs, const EdgeInfo & rhs_info) const
+	{
+		return lhs.weight < rhs.weight || (lhs.weight == rhs.weight && lhs_info.distance < rhs_info.distance);
+	}
+
+	// Из параллельных ребер остается самое быстрое, при равном времени - самое короткое, а при полном
+	// равенстве - добавленное раньше, которое и выбрал бы поиск. Время поездки растет с расстоянием
+	// при любых ожидании и скорости, поэтому отброшенные ребра не нужны и профилям маршрутов.
+	// Ребру edges[i] соответствует edges_info_[first_edge + i], порядок оставшихся ребер не меняется
+	size_t TransportRouter::RemoveDominatedEdges(std::vector<graph::Edge<Weight>> & edges, size_t first_edge) {
+		// Ребра группируются по началу сортировкой подсчетом, внутри группы порядок добавления сохраняется
+		const size_t vertex_count = vertex_name_at_id_.size();
+		std::vector<size_t> offsets(vertex_count + 1, 0);
+		for (const auto & edge : edges) {
+			++offsets[edge.from + 1];
+		}
+		for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+			offsets[vertex + 1] += offsets[vertex];
+		}
+		std::vector<size_t> order(edges.size());
+		std::vector<size_t> positions(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < edges.size(); ++i) {
+			order[positions[edges[i].from]++] = i;
+		}
+
+		// Лучшее ребро из текущей вершины в каждую вершину; метка - номер начала + 1
+		std::vector<size_t> best_edges(vertex_count);
+		std::vector<size_t> marks(vertex_count, 0);
+		std::vector<bool> is_kept(edges.size(), false);
+		for (size_t from = 0; from < vertex_count; ++from) {
+			for (size_t position = offsets[from]; position < offsets[from + 1]; ++position) {
+				const size_t i = order[position];
+				const graph::VertexId to = edges[i].to;
+				if (marks[to] != from + 1) {
+					marks[to] = from + 1;
+					best_edges[to] = i;
+					is_kept[i] = true;
+				} else if (IsFasterEdge(edges[i], edges_info_[first_edge + i],
+					edges[best_edges[to]], edges_info_[first_edge + best_edges[to]]))
+				{
+					is_kept[best_edges[to]] = false;
+					best_edges[to] = i;
+					is_kept[i] = true;
+				}
+			}
+		}
 
-					graph_->AddEdge(graph::Edge<Weight>{
-						vertex_id_at_name_.at(from_stop->name),
-						vertex_id_at_name_.at(to_stop->name),
-						Weight{
-							bus_ptr->name,
-							1.0 * distance / settings_.bus_velocity + settings_.bus_wait_time,
-							j - i
-						}
-					});
+		size_t kept_count = 0;
+		for (size_t i = 0; i < edges.size(); ++i) {
+			if (is_kept[i]) {
+				edges[kept_count] = edges[i];
+				edges_info_[first_edge + kept_count] = edges_info_[first_edge + i];
+				++kept_count;
+			}
+		}
+		const size_t dropped_count = edges.size() - kept_count;
+		edges.resize(kept_count);
+		edges_info_.resize(first_edge + kept_count);
+		return dropped_count;
+	}
+
+	// Ребра удаленного маршрута могли быть лучшими среди параллельных ребер других маршрутов, которые
+	// поэтому были отброшены. Ребра маршрутов через те же остановки строятся заново, и между парами
+	// вершин удаленных ребер возвращаются лучшие из них, если в графе не осталось ребра не хуже.
+	// Возвращает ребра для добавления в граф, их описания уже добавлены в конец edges_info_
+	std::vector<graph::Edge<TransportRouter::Weight>> TransportRouter::RestoreDominatedEdges(
+		const TransportCatalogue & catalogue, std::string_view removed_bus,
+		const std::vector<std::pair<graph::VertexId, graph::VertexId>> & pairs)
+	{
+		std::vector<graph::Edge<Weight>> edges;
+		// В модели LINEAR у каждого маршрута свои вершины "в автобусе", параллельных ребер нет
+		if (settings_.graph_model == GraphModel::LINEAR) {
+			return edges;
+		}
+		UpdateStopVertices(catalogue);
+		const size_t first_edge = edges_info_.size();
+		std::set<std::pair<graph::VertexId, graph::VertexId>> removed_pairs(pairs.begin(), pairs.end());
+		std::set<std::string_view> bus_names;
+		for (const auto & [from, to] : removed_pairs) {
+			if (auto stop = catalogue.FindStop(vertex_name_at_id_[from])) {
+				bus_names.insert((*stop)->buses.begin(), (*stop)->buses.end());
+			}
+		}
+		bus_names.erase(removed_bus);
+
+		for (std::string_view bus_name : bus_names) {
+			const std::optional<domain::BusPtr> bus = catalogue.FindRoute(bus_name);
+			if (!bus.has_value() || (*bus)->stops.size() < 2) {
+				continue;
+			}
+			const size_t first_bus_edge = edges.size();
+			AddBusEdges(*bus, edges);
+			size_t kept_count = first_bus_edge;
+			for (size_t i = first_bus_edge; i < edges.size(); ++i) {
+				if (removed_pairs.count({edges[i].from, edges[i].to})) {
+					edges[kept_count] = edges[i];
+					edges_info_[first_edge + kept_count] = edges_info_[first_edge + i];
+					++kept_count;
+				}
+			}
+			edges.resize(kept_count);
+			edges_info_.resize(first_edge + kept_count);
+		}
+		RemoveDominatedEdges(edges, first_edge);
+
+		// Ребро уже есть в графе, если оно или ребро не хуже пережило удаление
+		size_t kept_count = 0;
+		for (size_t i = 0; i < edges.size(); ++i) {
+			bool is_dominated = false;
+			for (graph::EdgeId edge_id : graph_->GetIncidentEdges(edges[i].from)) {
+				const auto & edge = graph_->GetEdge(edge_id);
+				if (edge.to == edges[i].to
+					&& !IsFasterEdge(edges[i], edges_info_[first_edge + i], edge, edges_info_[edge_id]))
+				{
+					is_dominated = true;
+					break;
 				}
 			}
+			if (!is_dominated) {
+				edges[kept_count] = edges[i];
+				edges_info_[first_edge + kept_count] = edges_info_[first_edge + i];
+				++kept_count;
+			}
+		}
+		edges.resize(kept_count);
+		edges_info_.resize(first_edge + kept_count);
+		return edges;
+	}
+
+	// У остановок, добавленных в справочник после построения графа, вершин еще нет
+	void TransportRouter::UpdateStopVertices(const TransportCatalogue & catalogue) {
+		if (vertex_id_at_stop_.size() < static_cast<size_t>(catalogue.GetStopCount())) {
+			vertex_id_at_stop_.resize(catalogue.GetStopCount(), NO_VERTEX);
 		}
 	}
 
+	// Название получает вершина остановки, через которую проходит хотя бы один маршрут
 	bool TransportRouter::AddVertex(size_t id, std::string_view name) {
-		if (!vertex_id_at_name_.count(name)) {
-			vertex_id_at_name_[name] = id;
-			vertex_name_at_id_.at(id) = name;
+		if (vertex_name_at_id_.at(id).empty()) {
+			vertex_name_at_id_[id] = name;
 			return true;
 		}
 		return false;
 	}
 
 	std::optional<TransportRouter::Route> TransportRouter::GetRoute(
-		std::string_view from, std::string_view to) const
+		domain::StopId from, domain::StopId to, const std::optional<RoutingProfile> & profile) const
+	{
+		return std::move(GetRoutes(from, {to}, profile).front());
+	}
+
+	std::vector<std::optional<TransportRouter::Route>> TransportRouter::GetRoutes(domain::StopId from,
+		const std::vector<domain::StopId> & to, const std::optional<RoutingProfile> & profile) const
 	{
-		if (!vertex_id_at_name_.count(from) || !vertex_id_at_name_.count(to)) {
+		std::vector<std::optional<Route>> result(to.size());
+		const std::optional<size_t> from_id = FindRouteStop(from);
+		if (!from_id) {
+			return result;
+		}
+
+		const Graph * graph = graph_.get();
+		const graph::Router<Weight> * router = router_.get();
+		const Raptor * raptor = raptor_.get();
+		int bus_wait_time = settings_.bus_wait_time;
+		// Маршруты профиля не кэшируются: кэш маршрутов общий для всех запросов без профиля
+		bool use_cache = route_cache_.GetCapacity() > 0;
+		std::shared_ptr<const ProfileRouter> profile_router;
+		if (profile.has_value() && (profile->bus_wait_time != default_profile_.bus_wait_time
+			|| profile->bus_velocity != default_profile_.bus_velocity))
+		{
+			// Маршрутизатор профиля не требует поиска по остановкам заново: структура графа та же
+			profile_router = GetProfileRouter(profile->bus_wait_time, ToMetersPerMinute(profile->bus_velocity));
+			graph = profile_router->graph.get();
+			router = profile_router->router.get();
+			raptor = profile_router->raptor.get();
+			bus_wait_time = profile_router->bus_wait_time;
+			use_cache = false;
+		}
+
+		// Ищутся только маршруты до найденных остановок, которых нет в кэше
+		std::vector<size_t> to_ids;
+		std::vector<size_t> positions;
+		const auto make_key = [this, &from_id](size_t to_id) {
+			return static_cast<uint64_t>(*from_id) * GetRouteStopCount() + to_id;
+		};
+		for (size_t i = 0; i < to.size(); ++i) {
+			const std::optional<size_t> to_id = FindRouteStop(to[i]);
+			if (!to_id) {
+				continue;
+			}
+			if (use_cache) {
+				if (auto cached = route_cache_.Get(make_key(*to_id))) {
+					result[i] = std::move(*cached);
+					continue;
+				}
+			}
+			to_ids.push_back(*to_id);
+			positions.push_back(i);
+		}
+		if (to_ids.empty()) {
+			return result;
+		}
+
+		std::vector<std::optional<Route>> routes = raptor
+			? BuildRaptorRoutes(*raptor, bus_wait_time, *from_id, to_ids)
+			: BuildRoutes(*graph, *router, bus_wait_time, *from_id, to_ids);
+		for (size_t i = 0; i < to_ids.size(); ++i) {
+			if (use_cache) {
+				route_cache_.Put(make_key(to_ids[i]), routes[i]);
+			}
+			result[positions[i]] = std::move(routes[i]);
+		}
+		return result;
+	}
+
+	TransportRouter::RoutingProfile TransportRouter::GetDefaultProfile() const {
+		return default_profile_;
+	}
+
+	std::optional<TransportRouter::RoutingProfile> TransportRouter::FindProfile(std::string_view name) const {
+		auto it = settings_.profiles.find(std::string(name));
+		if (it == settings_.profiles.end()) {
 			return std::nullopt;
 		}
+		return it->second;
+	}
+
+	// Веса ребер пересчитываются по сохраненным расстояниям за O(E), предподсчет не нужен
+	std::shared_ptr<const TransportRouter::ProfileRouter> TransportRouter::GetProfileRouter(
+		int bus_wait_time, double bus_velocity) const
+	{
+		const ProfileKey key{bus_wait_time, bus_velocity};
+		if (auto cached = profile_cache_.Get(key)) {
+			return *cached;
+		}
+		auto result = std::make_shared<ProfileRouter>();
+		result->bus_wait_time = bus_wait_time;
+		if (raptor_) {
+			result->raptor = std::make_unique<Raptor>(*raptor_);
+			result->raptor->SetProfile(bus_wait_time, bus_velocity);
+		} else {
+			std::vector<graph::Edge<Weight>> edges = graph_->GetEdges();
+			for (graph::EdgeId edge_id = 0; edge_id < edges.size(); ++edge_id) {
+				edges[edge_id].weight = ComputeEdgeWeight(edges_info_[edge_id], bus_wait_time, bus_velocity);
+			}
+			result->graph = std::make_unique<Graph>(graph_->GetVertexCount(), std::move(edges));
+			result->router = std::make_unique<graph::Router<Weight>>(*result->graph, graph::RouterStrategy::DIJKSTRA);
+		}
+		profile_cache_.Put(key, result);
+		return result;
+	}
 
-		auto graph_route = router_->BuildRoute(vertex_id_at_name_.at(from),
-			vertex_id_at_name_.at(to));
+	// Биты скорости и времени ожидания перемешиваются умножением, как ключи таблицы расстояний справочника.
+	// Старшие биты произведения складываются с младшими: по младшим выбирается сегмент кэша
+	size_t TransportRouter::ProfileKeyHasher::operator()(const ProfileKey & key) const {
+		uint64_t bits = 0;
+		std::memcpy(&bits, &key.second, sizeof(bits));
+		bits ^= static_cast<uint64_t>(static_cast<uint32_t>(key.first)) * 0x9E3779B97F4A7C15ull;
+		bits *= 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(bits ^ (bits >> 32));
+	}
 
-		if (!graph_route.has_value()) {
+	// Индекс остановки - вершина графа или индекс остановки RAPTOR. Остановка без маршрутов не находится
+	std::optional<size_t> TransportRouter::FindRouteStop(domain::StopId stop) const {
+		if (raptor_) {
+			return raptor_->FindStop(stop);
+		}
+		if (stop >= vertex_id_at_stop_.size()) {
 			return std::nullopt;
 		}
+		const graph::VertexId vertex = vertex_id_at_stop_[stop];
+		if (vertex == NO_VERTEX || vertex_name_at_id_[vertex].empty()) {
+			return std::nullopt;
+		}
+		return vertex;
+	}
+
+	size_t TransportRouter::GetRouteStopCount() const {
+		return raptor_ ? raptor_->GetStopCount() : vertex_name_at_id_.size();
+	}
+
+	TransportRouter::RouteMatrix TransportRouter::GetRouteMatrix(
+		const std::vector<domain::StopId> & from, const std::vector<domain::StopId> & to) const
+	{
+		// Остановки без вершины в поиск не передаются, их строки и столбцы остаются пустыми
+		const auto collect_vertices = [this](const std::vector<domain::StopId> & stops,
+			std::vector<graph::VertexId> & vertices, std::vector<size_t> & positions)
+		{
+			for (size_t i = 0; i < stops.size(); ++i) {
+				if (const std::optional<size_t> id = FindRouteStop(stops[i])) {
+					vertices.push_back(*id);
+					positions.push_back(i);
+				}
+			}
+		};
+		std::vector<graph::VertexId> sources, targets;
+		std::vector<size_t> rows, columns;
+		collect_vertices(from, sources, rows);
+		collect_vertices(to, targets, columns);
 
+		RouteMatrix result;
+		result.rows = from.size();
+		result.columns = to.size();
+		result.total_times.resize(from.size() * to.size());
+		if (raptor_) {
+			for (size_t i = 0; i < sources.size(); ++i) {
+				const std::vector<std::optional<double>> times = raptor_->ComputeTimes(sources[i]);
+				for (size_t j = 0; j < targets.size(); ++j) {
+					result.total_times[rows[i] * result.columns + columns[j]] = times[targets[j]];
+				}
+			}
+			return result;
+		}
+		const std::vector<std::optional<Weight>> weights = router_->BuildWeights(sources, targets);
+		for (size_t i = 0; i < sources.size(); ++i) {
+			for (size_t j = 0; j < targets.size(); ++j) {
+				result.total_times[rows[i] * result.columns + columns[j]] = weights[i * targets.size() + j];
+			}
+		}
+		return result;
+	}
+
+	std::optional<TransportRouter::Isochrone> TransportRouter::GetIsochrone(domain::StopId from, double max_time) const {
+		const std::optional<size_t> from_id = FindRouteStop(from);
+		if (!from_id) {
+			return std::nullopt;
+		}
+
+		Isochrone result;
+		if (raptor_) {
+			const std::vector<std::optional<double>> times = raptor_->ComputeTimes(*from_id, max_time);
+			for (size_t stop = 0; stop < times.size(); ++stop) {
+				if (times[stop].has_value()) {
+					result.items.push_back({raptor_->GetStopName(stop), *times[stop]});
+				}
+			}
+		} else {
+			// Вершины без названия (вершины "в автобусе" модели LINEAR) - не остановки
+			for (const auto & [vertex, weight] : router_->BuildReachable(*from_id, max_time)) {
+				if (!vertex_name_at_id_[vertex].empty()) {
+					result.items.push_back({vertex_name_at_id_[vertex], weight});
+				}
+			}
+		}
+		std::sort(result.items.begin(), result.items.end(), [](const auto & lhs, const auto & rhs) {
+			return std::tie(lhs.time, lhs.stop_name) < std::tie(rhs.time, rhs.stop_name);
+		});
+		return result;
+	}
+
+	cache::CacheStats TransportRouter::GetRouteCacheStats() const {
+		return route_cache_.GetStats();
+	}
+
+	std::vector<std::optional<TransportRouter::Route>> TransportRouter::BuildRoutes(const Graph & graph,
+		const graph::Router<Weight> & router, int bus_wait_time, graph::VertexId from,
+		const std::vector<graph::VertexId> & to) const
+	{
+		std::vector<std::optional<Route>> result(to.size());
+		std::vector<std::optional<graph::Router<Weight>::RouteInfo>> graph_routes = router.BuildRoutes(from, to);
+		for (size_t i = 0; i < to.size(); ++i) {
+			if (graph_routes[i].has_value()) {
+				result[i] = MakeRoute(graph, bus_wait_time, *graph_routes[i]);
+			}
+		}
+		return result;
+	}
+
+	TransportRouter::Route TransportRouter::MakeRoute(const Graph & graph, int bus_wait_time,
+		const graph::Router<Weight>::RouteInfo & graph_route) const
+	{
 		Route result;
-		result.total_time = graph_route->weight.time;
-		for (auto edge_id : graph_route->edges) {
-			auto edge = graph_->GetEdge(edge_id);
+		result.total_time = graph_route.weight;
+		for (auto edge_id : graph_route.edges) {
+			const auto & edge = graph.GetEdge(edge_id);
+			const EdgeInfo & info = edges_info_.at(edge_id);
+
+			if (info.type == EdgeType::BOARD) {
+				result.items.push_back(Segment{
+					SegmentType::WAIT,
+					vertex_name_at_id_.at(edge.from),
+					static_cast<double>(bus_wait_time)
+				});
+				result.items.push_back(Segment{SegmentType::BUS, info.bus_name, 0, 0});
+				continue;
+			}
+			if (info.type == EdgeType::RIDE) {
+				result.items.back().time += edge.weight;
+				result.items.back().span_count += info.span_count;
+				continue;
+			}
+			if (info.type == EdgeType::ALIGHT) {
+				continue;
+			}
 
 			result.items.push_back(Segment{
 				SegmentType::WAIT,
 				vertex_name_at_id_.at(edge.from),
-				static_cast<double>(settings_.bus_wait_time)
+				static_cast<double>(bus_wait_time)
 			});
 
 			result.items.push_back(Segment{
 				SegmentType::BUS,
-				edge.weight.name,
-				edge.weight.time - settings_.bus_wait_time,
-				edge.weight.span_count
+				info.bus_name,
+				edge.weight - bus_wait_time,
+				info.span_count
 			});
 		}
 
 		return result;
 	}
 
+	// Поездка RAPTOR - то же, что ребро STOP_PAIRS: ожидание на остановке посадки и проезд span_count остановок
+	std::vector<std::optional<TransportRouter::Route>> TransportRouter::BuildRaptorRoutes(const Raptor & raptor,
+		int bus_wait_time, size_t from, const std::vector<size_t> & to) const
+	{
+		std::vector<std::optional<Route>> result(to.size());
+		std::vector<std::optional<Raptor::Journey>> journeys = raptor.BuildJourneys(from, to);
+		for (size_t i = 0; i < to.size(); ++i) {
+			if (journeys[i].has_value()) {
+				result[i] = MakeRaptorRoute(bus_wait_time, *journeys[i]);
+			}
+		}
+		return result;
+	}
+
+	TransportRouter::Route TransportRouter::MakeRaptorRoute(int bus_wait_time, const Raptor::Journey & journey) const {
+		Route result;
+		result.total_time = journey.total_time;
+		for (const Raptor::Leg & leg : journey.legs) {
+			result.items.push_back(Segment{
+				SegmentType::WAIT,
+				leg.board_stop_name,
+				static_cast<double>(bus_wait_time)
+			});
+			result.items.push_back(Segment{
+				SegmentType::BUS,
+				leg.bus->name,
+				leg.time - bus_wait_time,
+				static_cast<int>(leg.alight - leg.board)
+			});
+		}
+		return result;
+	}
+
+	std::optional<TransportRouter::GraphStats> TransportRouter::GetGraphStats() const {
+		if (!graph_) {
+			return std::nullopt;
+		}
+		return GraphStats{graph_->GetVertexCount(), graph_->GetEdgeCount(), dominated_edge_count_};
+	}
+
+	bool TransportRouter::HasGraph() const {
+		return graph_ != nullptr;
+	}
+
+	TransportRouter::GraphData TransportRouter::GetGraphData() const {
+		GraphData result;
+		result.vertices = vertex_name_at_id_;
+		result.edges = graph_->GetEdges();
+		result.edges_info = edges_info_;
+		result.stops.resize(vertex_name_at_id_.size());
+		for (domain::StopId stop = 0; stop < vertex_id_at_stop_.size(); ++stop) {
+			if (vertex_id_at_stop_[stop] != NO_VERTEX) {
+				result.stops[vertex_id_at_stop_[stop]] = stop;
+			}
+		}
+		result.dominated_edge_count = dominated_edge_count_;
+		return result;
+	}
+
+	std::optional<graph::RoutesTableView<TransportRouter::Weight>> TransportRouter::GetRoutesTable() const {
+		if (!router_ || router_->GetStrategy() != graph::RouterStrategy::ALL_PAIRS) {
+			return std::nullopt;
+		}
+		return router_->GetRoutesTable();
+	}
+
+	const graph::LandmarksData<TransportRouter::Weight>* TransportRouter::GetLandmarksData() const {
+		if (!router_ || router_->GetStrategy() != graph::RouterStrategy::A_STAR) {
+			return nullptr;
+		}
+		return &router_->GetLandmarksData();
+	}
+
+	const graph::HierarchyData<TransportRouter::Weight>* TransportRouter::GetHierarchyData() const {
+		if (!router_ || router_->GetStrategy() != graph::RouterStrategy::CONTRACTION_HIERARCHY) {
+			return nullptr;
+		}
+		return &router_->GetHierarchyData();
+	}
+
 }
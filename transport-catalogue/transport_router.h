@@ -1,37 +1,23 @@
 #pragma once
 
 #include "graph.h"
+#include "lru_cache.h"
+#include "raptor.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
+#include <functional>
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include <map>
 #include <optional>
 #include <memory>
+#include <limits>
 
 namespace transport {
 	class TransportRouter {
 	private:
-		struct Weight {
-			std::string_view name;
-			double time = 0;
-			int span_count = 0;
-
-			bool operator < (Weight rhs) const {
-				return time < rhs.time;
-			}
-
-			bool operator > (Weight rhs) const {
-				return rhs.time < time;
-			}
-
-			Weight operator + (Weight rhs) const {
-				Weight result = *this;
-				result.time += rhs.time;
-				return result;
-			}
-		};
+		using Weight = double; // время в минутах
 
 	public:
 		enum class SegmentType {
@@ -48,28 +34,214 @@ namespace transport {
 			double total_time;
 			std::vector<Segment> items;
 		};
+		// Время в пути между каждой парой остановок: строки - начальные, столбцы - конечные остановки.
+		// Если маршрута нет, ячейка пуста
+		struct RouteMatrix {
+			size_t rows = 0;
+			size_t columns = 0;
+			std::vector<std::optional<double>> total_times; // ячейка row * columns + column
+		};
+		// Остановки, достижимые не более чем за max_time минут, в порядке возрастания времени
+		struct Isochrone {
+			struct Item {
+				std::string_view stop_name;
+				double time = 0;
+			};
+			std::vector<Item> items;
+		};
 
+		// Модель графа маршрутизатора
+		enum class GraphModel {
+			// Вершина на каждую остановку, ребро на каждую пару остановок каждого маршрута: O(L^2) ребер
+			STOP_PAIRS,
+			// Вершины "на остановке" и "в автобусе на остановке": O(L) ребер на маршрут
+			LINEAR
+		};
+		// Способ поиска маршрутов
+		enum class RouteEngine {
+			GRAPH, // поиск по графу стратегией strategy
+			RAPTOR // поиск по раундам прямо по маршрутам автобусов, граф не строится
+		};
+		// Время ожидания и скорость, по которым вычисляются веса ребер. Граф от них не зависит,
+		// поэтому маршрут можно искать с другими значениями без перестроения графа
+		struct RoutingProfile {
+			int bus_wait_time = 0; // минуты
+			double bus_velocity = 0; // км/ч
+		};
 		struct RouterSettings {
 			int bus_wait_time = 0; // минуты
-			double bus_velocity = 0; // метры в минуту
+			double bus_velocity = 0; // км/ч, после Init - метры в минуту
+			graph::RouterStrategy strategy = graph::RouterStrategy::ALL_PAIRS;
+			unsigned threads = 0; // потоки построения графа и предподсчета ALL_PAIRS, 0 - по числу ядер
+			GraphModel graph_model = GraphModel::STOP_PAIRS;
+			size_t route_cache_size = 4096; // число готовых маршрутов в кэше, 0 - без кэша
+			size_t landmark_count = 8; // опорные вершины A_STAR, 0 - только оценка по координатам
+			RouteEngine engine = RouteEngine::GRAPH;
+			std::map<std::string, RoutingProfile> profiles; // именованные профили
+			size_t profile_cache_size = 4; // число готовых маршрутизаторов для других профилей
+		};
+		enum class EdgeType {
+			TRIP, // ожидание и поездка через span_count остановок (STOP_PAIRS)
+			BOARD, // ожидание автобуса на остановке (LINEAR)
+			RIDE, // поездка до следующей остановки (LINEAR)
+			ALIGHT // выход из автобуса (LINEAR)
 		};
+		// Поездка, которой соответствует ребро графа. Вес ребра вычисляется по расстоянию и профилю
+		struct EdgeInfo {
+			std::string_view bus_name;
+			int span_count = 0;
+			EdgeType type = EdgeType::TRIP;
+			int distance = 0; // метры, у BOARD и ALIGHT - 0
+		};
+		// Граф в виде, пригодном для сохранения и восстановления без справочника
+		struct GraphData {
+			std::vector<std::string_view> vertices; // название остановки, ключ - индекс вершины
+			std::vector<graph::Edge<Weight>> edges;
+			std::vector<EdgeInfo> edges_info; // ключ - индекс ребра
+			// Координаты вершин для оценки A_STAR, ключ - индекс вершины. Не сохраняются в базе:
+			// для вершин остановок берутся из справочника, для вершин "в автобусе" - у их остановок
+			std::vector<std::optional<geo::Coordinates>> coordinates;
+			// Индекс остановки в справочнике, ключ - индекс вершины. Не сохраняется в базе, при загрузке
+			// остановки находятся по названиям вершин
+			std::vector<std::optional<domain::StopId>> stops;
+			size_t dominated_edge_count = 0; // см. GraphStats
+		};
+		// Размер графа. Из ребер с общими началом и концом при построении графа и добавлении маршрутов
+		// остается только самое быстрое, dominated_edge_count - число отброшенных параллельных ребер
+		struct GraphStats {
+			size_t vertex_count = 0;
+			size_t edge_count = 0;
+			size_t dominated_edge_count = 0;
+		};
+		// Готовая таблица маршрутов и владелец ее памяти
+		struct RoutesTable {
+			graph::RoutesTableView<Weight> view;
+			std::shared_ptr<const void> storage;
+		};
+		// Заранее вычисленные данные стратегии поиска маршрутов
+		struct Precomputed {
+			std::optional<RoutesTable> routes; // ALL_PAIRS
+			std::optional<graph::HierarchyData<Weight>> hierarchy; // CONTRACTION_HIERARCHY
+			std::optional<graph::LandmarksData<Weight>> landmarks; // A_STAR
+		};
+
 		TransportRouter() = default;
 		void Init(RouterSettings settings, const TransportCatalogue & catalogue);
-		std::optional<Route> GetRoute(std::string_view from, std::string_view to) const;
+		// Восстанавливает маршрутизатор из сохраненного графа, не повторяя предподсчет
+		void Init(RouterSettings settings, GraphData graph_data, Precomputed precomputed);
+		// Потокобезопасен: готовые маршруты кэшируются, кэш сбрасывается при каждом вызове Init.
+		// С профилем, отличным от настроек, поиск идет по графу с пересчитанными весами ребер (DIJKSTRA)
+		// или по RAPTOR с другими параметрами. Такие маршрутизаторы строятся за O(E) при первом запросе
+		// и кэшируются по профилю
+		// Остановки задаются индексами справочника: поиск по названию - в справочнике, на входе запроса
+		std::optional<Route> GetRoute(domain::StopId from, domain::StopId to,
+			const std::optional<RoutingProfile> & profile = std::nullopt) const;
+		// Маршруты из from до каждой остановки to, ключ - индекс в to. Маршруты, которых нет в кэше,
+		// находятся одним поиском из from (у ALL_PAIRS и CONTRACTION_HIERARCHY - по поиску на цель)
+		std::vector<std::optional<Route>> GetRoutes(domain::StopId from, const std::vector<domain::StopId> & to,
+			const std::optional<RoutingProfile> & profile = std::nullopt) const;
+		// Профиль из настроек маршрутизатора
+		RoutingProfile GetDefaultProfile() const;
+		std::optional<RoutingProfile> FindProfile(std::string_view name) const;
+		cache::CacheStats GetRouteCacheStats() const;
+		// Один поиск на начальную остановку вместо поиска на каждую пару
+		RouteMatrix GetRouteMatrix(const std::vector<domain::StopId> & from, const std::vector<domain::StopId> & to) const;
+		// Один поиск, ограниченный бюджетом времени. Если через остановку from не проходит ни один маршрут,
+		// возвращает nullopt
+		std::optional<Isochrone> GetIsochrone(domain::StopId from, double max_time) const;
+
+		// Изменение сети без полного перестроения: маршрут уже добавлен в справочник вместе с расстояниями
+		// между его остановками (или уже удален из справочника). Расстояния между остановками других маршрутов
+		// не должны меняться. В графе меняются только ребра маршрута, таблица ALL_PAIRS обновляется частично,
+		// иерархия CONTRACTION_HIERARCHY и опорные вершины A_STAR строятся заново. Кэш маршрутов сбрасывается.
+		// Не потокобезопасно с поиском маршрутов
+		void AddBus(const TransportCatalogue & catalogue, std::string_view name);
+		void RemoveBus(const TransportCatalogue & catalogue, std::string_view name);
+
+		// Графа нет у RAPTOR
+		bool HasGraph() const;
+		// Без графа - nullopt
+		std::optional<GraphStats> GetGraphStats() const;
+		GraphData GetGraphData() const;
+		// Таблица есть только у стратегии ALL_PAIRS
+		std::optional<graph::RoutesTableView<Weight>> GetRoutesTable() const;
+		// Иерархия есть только у стратегии CONTRACTION_HIERARCHY, иначе nullptr
+		const graph::HierarchyData<Weight>* GetHierarchyData() const;
+		// Опорные вершины есть только у стратегии A_STAR, иначе nullptr
+		const graph::LandmarksData<Weight>* GetLandmarksData() const;
 	private:
-		std::unordered_map<std::string_view, size_t> vertex_id_at_name_;
+		static constexpr graph::VertexId NO_VERTEX = std::numeric_limits<graph::VertexId>::max();
+		// Ключ - индекс остановки в справочнике, NO_VERTEX - у остановки нет вершины
+		std::vector<graph::VertexId> vertex_id_at_stop_;
 		std::vector<std::string_view> vertex_name_at_id_; // ключ - индекс в массиве
+		std::vector<EdgeInfo> edges_info_; // ключ - индекс ребра
+		std::vector<std::optional<geo::Coordinates>> vertex_coordinates_; // ключ - индекс вершины
+		size_t dominated_edge_count_ = 0;
 		RouterSettings settings_;
+		RoutingProfile default_profile_;
 
 		using Graph = graph::DirectedWeightedGraph<Weight>;
 		using GraphPtr = std::unique_ptr<Graph>;
 		using RouterPtr = std::unique_ptr<graph::Router<Weight>>;
+		std::shared_ptr<const void> routes_storage_ = nullptr; // объявлен раньше router_, чтобы пережить его
 		GraphPtr graph_ = nullptr;
 		RouterPtr router_ = nullptr;
+		std::unique_ptr<Raptor> raptor_ = nullptr;
+		// Ключ - from * количество вершин (остановок у RAPTOR) + to
+		mutable cache::ShardedLruCache<uint64_t, std::optional<Route>> route_cache_;
+
+		// Маршрутизатор для профиля, отличного от настроек: граф той же структуры с другими весами
+		struct ProfileRouter {
+			int bus_wait_time = 0;
+			GraphPtr graph = nullptr; // объявлен раньше router, чтобы пережить его
+			RouterPtr router = nullptr;
+			std::unique_ptr<Raptor> raptor = nullptr;
+		};
+		// Ключ - время ожидания и скорость в метрах в минуту
+		using ProfileKey = std::pair<int, double>;
+		struct ProfileKeyHasher {
+			size_t operator()(const ProfileKey & key) const;
+		};
+		mutable cache::ShardedLruCache<ProfileKey, std::shared_ptr<const ProfileRouter>, ProfileKeyHasher> profile_cache_;
+
+		// Ребра одного маршрута и их описания в порядке ребер
+		struct BusEdges {
+			std::vector<graph::Edge<Weight>> edges;
+			std::vector<EdgeInfo> info;
+		};
 
 		void MakeGraph(const TransportCatalogue & catalogue);
+		void MakeRouter();
+		void AddBusEdges(domain::BusPtr bus, std::vector<graph::Edge<Weight>> & edges);
+		size_t RemoveDominatedEdges(std::vector<graph::Edge<Weight>> & edges, size_t first_edge);
+		std::vector<bool> RemoveEdgesDominatedByGraph(std::vector<graph::Edge<Weight>> & edges, size_t first_edge);
+		std::vector<std::optional<graph::EdgeId>> RemoveGraphEdges(const std::function<bool(graph::EdgeId)> & is_removed);
+		size_t CountBusEdges(const TransportCatalogue & catalogue) const;
+		bool IsFasterEdge(const graph::Edge<Weight> & lhs, const EdgeInfo & lhs_info,
+			const graph::Edge<Weight> & rhs, const EdgeInfo & rhs_info) const;
+		std::vector<graph::Edge<Weight>> RestoreDominatedEdges(const TransportCatalogue & catalogue,
+			std::string_view removed_bus, const std::vector<std::pair<graph::VertexId, graph::VertexId>> & pairs);
+		void MakeBusEdges(domain::BusPtr bus, graph::VertexId first_ride_vertex, BusEdges & result) const;
+		void AddStopPairsEdges(domain::BusPtr bus, const std::vector<graph::VertexId> & stop_vertices,
+			BusEdges & result) const;
+		void AddLinearEdges(domain::BusPtr bus, const std::vector<graph::VertexId> & stop_vertices,
+			graph::VertexId first_ride_vertex, BusEdges & result) const;
 		bool AddVertex(size_t id, std::string_view name);
+		void UpdateStopVertices(const TransportCatalogue & catalogue);
 		void SetSettings(RouterSettings settings);
+		std::vector<std::optional<Route>> BuildRoutes(const Graph & graph, const graph::Router<Weight> & router,
+			int bus_wait_time, graph::VertexId from, const std::vector<graph::VertexId> & to) const;
+		Route MakeRoute(const Graph & graph, int bus_wait_time, const graph::Router<Weight>::RouteInfo & graph_route) const;
+		std::vector<std::optional<Route>> BuildRaptorRoutes(const Raptor & raptor, int bus_wait_time, size_t from,
+			const std::vector<size_t> & to) const;
+		Route MakeRaptorRoute(int bus_wait_time, const Raptor::Journey & journey) const;
+		std::shared_ptr<const ProfileRouter> GetProfileRouter(int bus_wait_time, double bus_velocity) const;
+		static Weight ComputeEdgeWeight(const EdgeInfo & info, int bus_wait_time, double bus_velocity);
+		std::optional<size_t> FindRouteStop(domain::StopId stop) const;
+		size_t GetRouteStopCount() const;
+		void SetRideVertexCoordinates(domain::BusPtr bus, graph::VertexId first_ride_vertex);
+		void CompleteVertexCoordinates();
+		graph::LowerBound<Weight> MakeLowerBound() const;
 	};
 
 }